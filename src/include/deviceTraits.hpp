@@ -0,0 +1,80 @@
+#pragma once
+#include <duaLib.h>
+#include <duaLibUtils.hpp>
+
+namespace duaLibUtils {
+	// D-pad hat value to SCE_BM_*_DPAD bits, 8 and up is released
+	constexpr uint32_t dpadButtons[16] = {
+		SCE_BM_N_DPAD,
+		SCE_BM_N_DPAD | SCE_BM_E_DPAD,
+		SCE_BM_E_DPAD,
+		SCE_BM_S_DPAD | SCE_BM_E_DPAD,
+		SCE_BM_S_DPAD,
+		SCE_BM_S_DPAD | SCE_BM_W_DPAD,
+		SCE_BM_W_DPAD,
+		SCE_BM_N_DPAD | SCE_BM_W_DPAD,
+	};
+
+	// What the shared translator needs to know about a device's input report. The readers unpack BT and USB
+	// reports into the same state struct, so traits only differ per device. Edge pads use the DualSense traits.
+	struct dualsenseTraits {
+		using inputState = dualsenseData::USBGetStateData;
+
+		static const inputState& input(const controller& controller) { return controller.dualsenseCurInputState; }
+		static bool share(const inputState& state) { return state.ButtonCreate; }
+		static uint64_t timestamp(const inputState& state) { return state.DeviceTimeStamp; }
+		// Sensor clock between two reports, it ticks every 1/3 us and wraps after ~24 minutes. Rounded against the
+		// absolute clock, so the fraction of a us dropped per report doesn't add up.
+		static uint32_t sensorDeltaUs(uint32_t from, uint32_t to) { return static_cast<uint32_t>((from % 3 + static_cast<uint64_t>(to - from)) / 3); }
+
+		static void touch(const inputState& state, s_ScePadTouchData& touch) {
+			touch.touchNum = !state.touchData.Finger[0].NotTouching + !state.touchData.Finger[1].NotTouching;
+			for (int i = 0; i < 2; i++) {
+				touch.touch[i].id = state.touchData.Finger[i].Index;
+				touch.touch[i].x = state.touchData.Finger[i].FingerX;
+				touch.touch[i].y = state.touchData.Finger[i].FingerY;
+			}
+		}
+	};
+
+	struct dualshock4Traits {
+		using inputState = dualshock4Data::USBGetStateData;
+
+		static const inputState& input(const controller& controller) { return controller.dualshock4CurInputState; }
+		static bool share(const inputState& state) { return state.ButtonShare; }
+		static uint64_t timestamp(const inputState& state) { return state.Timestamp; }
+		// 16 bit clock in 16/3 us ticks, wraps every ~350 ms so only consecutive reports can be told apart.
+		// Rounded against the absolute clock like the DualSense one, 16 * from leaves the same remainder as from.
+		static uint32_t sensorDeltaUs(uint16_t from, uint16_t to) { return (from % 3u + static_cast<uint16_t>(to - from) * 16u) / 3u; }
+
+		static void touch(const inputState& state, s_ScePadTouchData& touch) {
+			touch.touchNum = !state.Finger1Active + !state.Finger2Active; // the bit is set while the finger is up
+			touch.touch[0].id = state.Finger1ID;
+			touch.touch[0].x = state.Finger1X;
+			touch.touch[0].y = state.Finger1Y;
+			touch.touch[1].id = state.Finger2ID;
+			touch.touch[1].x = state.Finger2X;
+			touch.touch[1].y = state.Finger2Y;
+		}
+	};
+
+	// Branchless, every button bit is 0 or 1 so it scales its SCE_BM_* flag directly
+	template <typename Traits>
+	uint32_t buttonMask(const typename Traits::inputState& state) {
+		return state.ButtonCross * SCE_BM_CROSS
+			| state.ButtonCircle * SCE_BM_CIRCLE
+			| state.ButtonTriangle * SCE_BM_TRIANGLE
+			| state.ButtonSquare * SCE_BM_SQUARE
+			| state.ButtonL1 * SCE_BM_L1
+			| state.ButtonL2 * SCE_BM_L2
+			| state.ButtonR1 * SCE_BM_R1
+			| state.ButtonR2 * SCE_BM_R2
+			| state.ButtonL3 * SCE_BM_L3
+			| state.ButtonR3 * SCE_BM_R3
+			| state.ButtonOptions * SCE_BM_OPTIONS
+			| state.ButtonPad * SCE_BM_TOUCH
+			| Traits::share(state) * SCE_BM_SHARE // masked by scePadReadState outside of particular mode
+			| state.ButtonHome * SCE_BM_PSBTN
+			| dpadButtons[static_cast<uint8_t>(state.DPad) & 0x0F];
+	}
+}
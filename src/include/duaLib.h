@@ -367,13 +367,107 @@ enum s_SceControllerType {
 #define SCE_PAD_BUSTYPE_USB 1
 #define SCE_PAD_BUSTYPE_BT 2
 
+// I/O thread modes (s_ScePadInitParam::ioThreadMode)
+#define SCE_PAD_IO_THREAD_SHARED 0         // One reader thread services every controller
+#define SCE_PAD_IO_THREAD_PER_CONTROLLER 1 // Every controller slot gets its own reader/writer thread
+
+// I/O thread scheduling classes (s_ScePadInitParam::ioSchedPolicy), Linux only
+#define SCE_PAD_IO_SCHED_DEFAULT 0 // Leave the thread as created
+#define SCE_PAD_IO_SCHED_OTHER 1   // SCHED_OTHER, ioPriority is the nice value (-20~19)
+#define SCE_PAD_IO_SCHED_FIFO 2    // SCHED_FIFO, ioPriority is the real-time priority (1~99). Needs CAP_SYS_NICE
+
+// I/O latency/CPU policies (s_ScePadInitParam::ioPolicy)
+// DUALIB_IO_POLICY can be set to balanced, busy, hybrid or blocking to override it without rebuilding.
+// Use scePadGetIoStatistics() to see what a policy costs on the target machine.
+#define SCE_PAD_IO_POLICY_BALANCED 0  // Block on devices the OS lets us wait on (hidraw), sleep until just before the predicted report and spin briefly for the rest
+#define SCE_PAD_IO_POLICY_BUSY_POLL 1 // Never sleep. Lowest latency but takes a whole core, pinned to the last CPU unless ioAffinityMask[0] is set
+#define SCE_PAD_IO_POLICY_HYBRID 2    // Like balanced but also spins through the predicted arrival of devices it could block on, trading CPU for wakeup latency
+#define SCE_PAD_IO_POLICY_BLOCKING 3  // Never spin and wake at most once per report, polled devices are read just after their predicted arrival. Lowest CPU cost
+
+struct s_ScePadIoStatistics {
+	uint32_t policy;         // SCE_PAD_IO_POLICY_* in effect
+	float cpuUsage;          // CPU time of the I/O threads divided by wall time since scePadInit, 1.0 is one full core
+	float wakeupsPerSecond;  // I/O thread wakeups per second since scePadInit
+	float averageLatencyUs;  // Report arrival to published state, estimated against the learned report cadence
+	float maxLatencyUs;
+	uint64_t reports;        // Input reports received from all controllers
+	uint64_t coalescedReports; // Reports superseded by a newer one before being published
+};
+
+// Per handle bring-up timings. A restore is a bring-up whose full output state replay reached the pad,
+// timed from the device being discovered.
+struct s_ScePadConnectionStatistics {
+	uint32_t restores;
+	uint32_t reconnects;     // Pads that came back and got bound to their previous handle
+	float lastRestoreUs;
+	float averageRestoreUs;
+	float maxRestoreUs;
+};
+
+// Gravity split out of s_ScePadData::acceleration at sensor rate, same axes and units (g)
+struct s_ScePadMotionData {
+	s_SceFVector3 gravity;            // Unit length while the pad is tracked
+	s_SceFVector3 linearAcceleration; // acceleration - gravity
+};
+
+// Motion gestures (s_ScePadGestureConfig::enabledGestures, s_ScePadGestureEvent::type)
+#define SCE_PAD_GESTURE_SHAKE 0x01 // Linear acceleration strokes back and forth
+#define SCE_PAD_GESTURE_TAP   0x02 // Short linear acceleration spike, e.g. knocking on the pad
+#define SCE_PAD_GESTURE_FLICK 0x04 // Short burst of fast rotation
+#define SCE_PAD_GESTURE_TWIST 0x08 // Sustained rotation past an angle about one axis
+
+// Zero fields take the default in brackets
+struct s_ScePadGestureConfig {
+	uint32_t enabledGestures; // SCE_PAD_GESTURE_* mask, 0 turns the recognizer off
+	float shakeThreshold;     // g of linear acceleration per stroke (1.5)
+	uint32_t shakeCount;      // Direction reversals (3)
+	uint32_t shakeWindowUs;   // Longest gap between strokes (250000)
+	float tapThreshold;       // g (2.5)
+	uint32_t tapMaxUs;        // Longest spike that still counts as a tap (30000)
+	float flickThreshold;     // rad/s (10)
+	uint32_t flickMaxUs;      // Longest burst that still counts as a flick (150000)
+	float twistAngle;         // rad (1.2)
+	uint32_t cooldownUs;      // Per gesture type, after an event (200000)
+};
+
+struct s_ScePadGestureEvent {
+	uint32_t type;      // One SCE_PAD_GESTURE_* bit
+	uint8_t axis;       // 0-2, x/y/z of s_ScePadData::acceleration/angularVelocity the gesture was strongest on
+	int8_t direction;   // 1 or -1 along that axis
+	uint16_t reserved;
+	float magnitude;    // Peak g for shake/tap, peak rad/s for flick, rad for twist
+	uint64_t timestamp; // std::chrono::steady_clock us when the report was processed
+};
+
+// Slot connection changes (s_ScePadConnectionEvent::state)
+#define SCE_PAD_CONNECTION_OPENING 1      // A new pad claimed the slot and is being set up
+#define SCE_PAD_CONNECTION_RECONNECTING 2 // The pad that left the slot came back, its output state gets replayed
+#define SCE_PAD_CONNECTION_LIVE 3         // Set up, reports are flowing
+#define SCE_PAD_CONNECTION_LOST 4         // The pad went away, the handle stays valid until it comes back
+
+struct s_ScePadConnectionEvent {
+	uint32_t state;     // SCE_PAD_CONNECTION_*
+	uint32_t reserved;
+	uint64_t timestamp; // std::chrono::steady_clock us of the transition
+};
+
 struct s_ScePadInitParam {
 	uint8_t  customAllocAndFree[16]; // Can be left unused
 	uint32_t allowBT;         // Set to 1 to allow Bluetooth connections, 0 to disable
-	uint64_t  padding1[2];      
+	// duaLib extensions below take the place of the original padding, a zeroed struct keeps the default behavior
+	uint8_t  ioThreadMode;    // SCE_PAD_IO_THREAD_*
+	uint8_t  ioSchedPolicy;   // SCE_PAD_IO_SCHED_*
+	int8_t   ioPriority;      // See SCE_PAD_IO_SCHED_*
+	uint8_t  ioPolicy;        // SCE_PAD_IO_POLICY_*, the DUALIB_IO_POLICY environment variable overrides it
+	uint32_t ioAffinityMask[4]; // CPU mask for the I/O thread of each controller slot, 0 leaves it unpinned. [0] is used by the shared reader
 	uint32_t  padding2;       
+	uint32_t  padding3;
 };
 
+#if defined(__cplusplus) && __cplusplus >= 201103L
+static_assert(sizeof(s_ScePadInitParam) == 48, "s_ScePadInitParam has incorrect size");
+#endif
+
 #if defined(_WIN32) || defined(_WIN64)
 	#ifdef DUALIB_EXPORTS
 		#define DUALIB_API __declspec(dllexport)
@@ -423,6 +517,23 @@ DUALIB_API int scePadSetVibrationMode(int handle, int mode);
 DUALIB_API int scePadSetVolumeGain(int handle, s_ScePadVolumeGain* gainSettings);
 DUALIB_API int scePadIsSupportedAudioFunction(int handle);
 DUALIB_API int scePadClose(int handle);
+DUALIB_API int scePadGetIoStatistics(s_ScePadIoStatistics* stats);
+DUALIB_API int scePadGetConnectionStatistics(int handle, s_ScePadConnectionStatistics* stats);
+// duaLib extension, learns the gyro bias while the pad lies still and subtracts it from every sample
+DUALIB_API int scePadSetGyroBiasEstimationState(int handle, bool state);
+// duaLib extension, scePadReadState extrapolated to targetTimeUs (std::chrono::steady_clock, microseconds since its epoch)
+// e.g. when the frame will hit the display. Orientation, angular velocity and sticks are predicted, at most 50 ms ahead.
+DUALIB_API int scePadReadStateAt(int handle, s_ScePadData* data, int64_t targetTimeUs);
+// duaLib extension, radians turned about the angularVelocity axes since the previous call, integrated over every report
+DUALIB_API int scePadGetAccumulatedRotation(int handle, s_SceFVector3* rotation);
+// duaLib extension, gravity and gravity-free linear acceleration of the newest report
+DUALIB_API int scePadGetMotionData(int handle, s_ScePadMotionData* motionData);
+// duaLib extension, gestures are recognized on the I/O thread from every report and queued until polled
+DUALIB_API int scePadSetGestureConfig(int handle, const s_ScePadGestureConfig* config);
+// Returns the number of events written, oldest first
+DUALIB_API int scePadGetGestureEvents(int handle, s_ScePadGestureEvent* events, int maxCount);
+// duaLib extension, connection changes of the handle's slot queued until polled. Returns the number of events written, oldest first
+DUALIB_API int scePadGetConnectionEvents(int handle, s_ScePadConnectionEvent* events, int maxCount);
 #ifdef __cplusplus
 }
 #endif
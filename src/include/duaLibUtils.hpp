@@ -1,9 +1,12 @@
 #pragma once
 #include <dataStructures.h>
+#include <atomic>
+#include <cstring>
 #include <mutex>
 #include <hidapi.h>
 #include <shared_mutex>
 #include <string>
+#include <thread>
 #include <cstdint>
 #include <duaLib.h>
 #include <vector>
@@ -19,65 +22,401 @@
 #define DUALSHOCK4_DEVICE_ID 0x05c4
 #define DUALSHOCK4V2_DEVICE_ID 0x09cc
 #define DUALSHOCK4_WIRELESS_ADAPTOR_ID 0xba0
+#define MAX_DRAINED_REPORTS 64 // hidraw buffers at most 64 reports per reader
+#define MAX_FAILED_READS 15 // consecutive read errors before a controller counts as disconnected
+#define SNAPSHOT_BUFFER_COUNT 4
+#define COMMAND_QUEUE_SIZE 64 // power of two
+#define CACHE_LINE_SIZE 64
+#define GESTURE_QUEUE_SIZE 32 // power of two, events past it are dropped until the game polls
+#define CONNECTION_QUEUE_SIZE 16 // power of two, same
+#define GYRO_DEFAULT_SCALE (2000.0f / 32767.0f * 3.14159265f / 180.0f) // 2000 deg/s full scale (BMI055 data sheet Chapter 7.2.1)
+#define ACCEL_DEFAULT_SCALE (1.0f / 8192.0f) // 2^13 LSB per g
 
 namespace duaLibUtils {
 	struct trigger {
 		uint8_t force[11] = {};
 	};
 
+	// Single writer snapshot published by the I/O thread. Each buffer is its own seqlock and the writer rotates
+	// through them, so readers never block the writer or each other and only retry if the writer lapped the
+	// whole ring during their copy. The payload is copied through atomic words so torn copies aren't UB.
+	template <typename T>
+	struct snapshot {
+		static constexpr size_t wordCount = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+		struct alignas(CACHE_LINE_SIZE) buffer {
+			std::atomic<uint32_t> sequence = 0;
+			std::atomic<uint64_t> words[wordCount] = {};
+		};
+
+		alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> latest = 0;
+		std::atomic<bool> published = false;
+		buffer buffers[SNAPSHOT_BUFFER_COUNT] = {};
+
+		void store(const T& value) {
+			uint64_t words[wordCount] = {};
+			std::memcpy(words, &value, sizeof(T));
+
+			uint32_t index = (latest.load(std::memory_order_relaxed) + 1) % SNAPSHOT_BUFFER_COUNT;
+			auto& target = buffers[index];
+			uint32_t sequence = target.sequence.load(std::memory_order_relaxed);
+
+			target.sequence.store(sequence + 1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+			for (size_t i = 0; i < wordCount; i++) {
+				target.words[i].store(words[i], std::memory_order_relaxed);
+			}
+			target.sequence.store(sequence + 2, std::memory_order_release);
+
+			latest.store(index, std::memory_order_release);
+			published.store(true, std::memory_order_release);
+		}
+
+		// Returns false if nothing was published yet
+		bool load(T& value) const {
+			if (!published.load(std::memory_order_acquire)) return false;
+
+			uint64_t words[wordCount];
+			for (;;) {
+				const auto& source = buffers[latest.load(std::memory_order_acquire)];
+				uint32_t before = source.sequence.load(std::memory_order_acquire);
+				if (before & 1) continue;
+
+				for (size_t i = 0; i < wordCount; i++) {
+					words[i] = source.words[i].load(std::memory_order_relaxed);
+				}
+				std::atomic_thread_fence(std::memory_order_acquire);
+
+				if (source.sequence.load(std::memory_order_relaxed) == before) break;
+			}
+
+			std::memcpy(&value, words, sizeof(T));
+			return true;
+		}
+
+		void clear() {
+			published.store(false, std::memory_order_release);
+		}
+	};
+
+	// Bounded multi producer ring (Vyukov). Game threads push without locks, the I/O thread pops.
+	template <typename T, size_t Capacity>
+	struct commandRing {
+		static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+		struct cell {
+			std::atomic<size_t> sequence;
+			T value;
+		};
+
+		alignas(CACHE_LINE_SIZE) cell cells[Capacity];
+		alignas(CACHE_LINE_SIZE) std::atomic<size_t> head = 0; // next push
+		alignas(CACHE_LINE_SIZE) std::atomic<size_t> tail = 0; // next pop
+
+		commandRing() {
+			for (size_t i = 0; i < Capacity; i++) {
+				cells[i].sequence.store(i, std::memory_order_relaxed);
+			}
+		}
+
+		// Returns false if the ring is full
+		bool push(const T& value) {
+			size_t position = head.load(std::memory_order_relaxed);
+
+			for (;;) {
+				cell& target = cells[position & (Capacity - 1)];
+				size_t sequence = target.sequence.load(std::memory_order_acquire);
+				intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+
+				if (difference == 0) {
+					if (head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+						target.value = value;
+						target.sequence.store(position + 1, std::memory_order_release);
+						return true;
+					}
+				}
+				else if (difference < 0) {
+					return false;
+				}
+				else {
+					position = head.load(std::memory_order_relaxed);
+				}
+			}
+		}
+
+		// Single consumer
+		bool pop(T& value) {
+			size_t position = tail.load(std::memory_order_relaxed);
+			cell& source = cells[position & (Capacity - 1)];
+
+			if (source.sequence.load(std::memory_order_acquire) != position + 1) return false;
+
+			value = source.value;
+			source.sequence.store(position + Capacity, std::memory_order_release);
+			tail.store(position + 1, std::memory_order_relaxed);
+			return true;
+		}
+	};
+
+	enum class outputCommandType : uint8_t {
+		LightBar,
+		PlayerColor, // DS4 only, the DualSense shows the player with its indicator lights
+		Vibration,
+		VibrationMode,
+		TriggerEffect,
+		VolumeGain,
+		AudioOutPath
+	};
+
+	// One setter call, applied to the output state by the I/O thread at the next report
+	struct outputCommand {
+		outputCommandType type = outputCommandType::LightBar;
+		uint8_t triggerMask = 0;
+		uint8_t values[4] = {}; // rgb, large/small motor, speaker/mic/headset volume, audio path or vibration mode
+		trigger L2 = {};
+		trigger R2 = {};
+	};
+
+	// Report cadence learned from the device clock, used to sleep until the next report is due
+	struct reportTiming {
+		int64_t lastArrivalUs = 0; // estimated host time the newest report arrived at
+		float intervalUs = 0.0f;   // 0 until enough reports were seen
+		uint64_t reports = 0;
+		uint64_t latencySamples = 0;
+		double latencySumUs = 0.0;
+		float latencyMaxUs = 0.0f;
+	};
+
+	// Raw IMU sample -> rad/s and g, per axis of the state structs. Defaults to the data sheet ranges until the
+	// pad's factory calibration was read.
+	struct imuCalibration {
+		float gyroScale[3] = { GYRO_DEFAULT_SCALE, GYRO_DEFAULT_SCALE, GYRO_DEFAULT_SCALE };
+		float gyroBias[3] = {};
+		float accelScale[3] = { ACCEL_DEFAULT_SCALE, ACCEL_DEFAULT_SCALE, ACCEL_DEFAULT_SCALE };
+		float accelBias[3] = {};
+		bool factory = false;
+	};
+
+	// Online gyro bias, learned while the pad lies still. Rest readings are fitted against the IMU temperature
+	// (bias = mean + slope * (temperature - mean temperature)), so warm-up drift keeps being corrected in play.
+	struct gyroBiasEstimate {
+		s_SceFVector3 bias = { 0.0f,0.0f,0.0f }; // rad/s at the current temperature, subtracted from every sample
+		s_SceFVector3 accelMean = { 0.0f,0.0f,0.0f };
+		float accelVariance = 1.0f; // starts "moving" until the mean settled
+		uint32_t restUs = 0; // how long the pad has been still
+		double weight = 0.0; // us of rest readings, slowly forgotten
+		double sumT = 0.0;
+		double sumTT = 0.0;
+		double sumB[3] = {};
+		double sumTB[3] = {};
+	};
+
+	// Gesture recognizer, I/O thread only. Times are on the device clock.
+	struct gestureState {
+		s_ScePadGestureConfig config = {}; // with defaults filled in
+		uint64_t timeUs = 0;
+		uint64_t cooldownUntilUs[4] = {};
+		s_SceFVector3 shakeDirection = { 0.0f,0.0f,0.0f }; // of the last stroke
+		uint64_t shakeLastUs = 0;
+		uint64_t shakeSequenceUs = 0; // first stroke after a quiet window
+		uint32_t shakeReversals = 0;
+		float shakePeak = 0.0f;
+		bool shakeStroke = false; // above the threshold right now
+		uint64_t tapStartUs = 0;
+		s_SceFVector3 tapPeak = { 0.0f,0.0f,0.0f };
+		bool tapActive = false;
+		uint64_t tapReleaseUs = 0;
+		bool tapPending = false; // waiting out the shake window
+		uint64_t flickStartUs = 0;
+		s_SceFVector3 flickPeak = { 0.0f,0.0f,0.0f };
+		bool flickActive = false;
+		float twistAngle[3] = {};
+	};
+
+	// Published by the I/O thread per report, the translated state plus what scePadReadStateAt extrapolates with
+	struct publishedState {
+		s_ScePadData data = {};
+		int64_t sampleUs = 0; // host time the report arrived at
+		s_SceFVector3 angularAcceleration = { 0.0f,0.0f,0.0f }; // rad/s^2
+		float stickVelocity[4] = {}; // left x/y, right x/y in units per us
+		double rotation[3] = {}; // radians turned since the slot first came up, see scePadGetAccumulatedRotation
+		s_ScePadMotionData motion = {};
+	};
+
+	// Bring-up/reconnect to the whole output state being back on the device
+	struct restoreTiming {
+		int64_t startUs = 0; // when the device was discovered, 0 once restored
+		uint32_t restores = 0;
+		uint32_t reconnects = 0; // bring-ups of a pad that came back to its previous slot
+		float lastUs = 0.0f;
+		float maxUs = 0.0f;
+		double totalUs = 0.0;
+	};
+
+	// reportTiming/restoreTiming counters the statistics getters read, copied out by the I/O thread
+	struct ioStatistics {
+		uint64_t reports = 0;
+		uint64_t coalescedReports = 0;
+		uint64_t latencySamples = 0;
+		double latencySumUs = 0.0;
+		float latencyMaxUs = 0.0f;
+		uint32_t restores = 0;
+		uint32_t reconnects = 0;
+		float lastRestoreUs = 0.0f;
+		float maxRestoreUs = 0.0f;
+		double totalRestoreUs = 0.0;
+	};
+
+	// Slot lifecycle. Bring-up claims a free slot (Empty/Lost/Closed) as Opening, or Reconnecting when the pad that
+	// left it comes back, and publishes it Live once the device is set up. The reader or a hidraw remove event
+	// takes it Live -> Lost, scePadClose/scePadTerminate Closed. Whoever releases the handle, fd or state after
+	// the slot left Live waits for waitIoIdle first, an I/O pass that saw it Live may still be running.
+	enum class connectionState : uint8_t {
+		Empty,
+		Opening,
+		Live,
+		Lost,
+		Reconnecting,
+		Closed
+	};
+
+	// Grouped by who touches what so the four slots don't false share. The slot header is read by every
+	// scePad* call, the reader block and the output block are I/O thread only, the rest is bring-up metadata.
 	struct controller {
-		std::shared_mutex lock{};
-		hid_device* handle = 0;
+		// Slot header, game threads
+		alignas(CACHE_LINE_SIZE) std::shared_mutex lock{};
 		uint32_t sceHandle = 0;
 		uint8_t playerIndex = 0;
 		uint8_t deviceType = UNKNOWN;
-		uint16_t productID = 0;
-		uint8_t seqNo = 0;
 		uint8_t connectionType = 0;
+		uint16_t productID = 0;
 		bool opened = false;
+		std::atomic<connectionState> connection = connectionState::Empty;
+		std::atomic<bool> ioBusy = false; // an I/O pass is inside the slot, see enterIo
+		std::atomic<bool> velocityDeadband = false; // setter flags, game threads write, the I/O thread reads per report
+		std::atomic<bool> gyroBiasEstimation = false;
+		std::atomic<bool> motionSensorState = true;
+		std::atomic<bool> tiltCorrection = false;
+		std::atomic<bool> orientationReset = false; // set by scePadResetOrientation, applied by the I/O thread
+		commandRing<outputCommand, COMMAND_QUEUE_SIZE> commands = {}; // setters -> I/O thread
+		snapshot<publishedState> state = {}; // translated input, published once per report
+		snapshot<ioStatistics> statistics = {}; // published with the state
+		std::mutex rotationLock{};
+		double rotationRead[3] = {}; // published rotation at the last scePadGetAccumulatedRotation
+		bool rotationBaseline = false; // cleared by scePadOpen, the first call after it only sets the baseline
+		std::mutex gestureLock{}; // game side, config writes and event reads
+		s_ScePadGestureConfig gestureConfig = {}; // picked up by the I/O thread when gestureConfigChanged is set
+		std::atomic<bool> gestureConfigChanged = false;
+		commandRing<s_ScePadGestureEvent, GESTURE_QUEUE_SIZE> gestureEvents = {}; // I/O thread -> game
+		std::mutex connectionEventLock{}; // game side, the ring has a single consumer
+		commandRing<s_ScePadConnectionEvent, CONNECTION_QUEUE_SIZE> connectionEvents = {}; // bring-up/I/O/watcher -> game
+
+		// Reader, I/O thread only
+		alignas(CACHE_LINE_SIZE) hid_device* handle = 0;
+		int inputFd = -1; // Linux only, hidraw node opened by the reader so it can block on it
+		uint32_t failedReadCount = 0; // consecutive read errors, the reader's liveness signal
+		uint64_t coalescedReports = 0; // reports read but superseded by a newer one in the same pass
+		reportTiming timing = {};
+		uint8_t seqNo = 0;
 		bool isMicMuted = false;
-		bool wasDisconnected = false;
-		bool valid = false;
-		uint32_t failedReadCount = 0;
-		dualsenseData::USBGetStateData dualsenseCurInputState = {};
-		dualsenseData::SetStateData dualsenseLastOutputState = {};
-		dualsenseData::SetStateData dualsenseCurOutputState = {};
-		dualsenseData::ReportFeatureInVersion versionReport = {};
+		bool wasDisconnected = false; // set by bring-up before the slot goes Live, cleared once the output state was replayed
+		uint32_t lastSensorTimestamp = 0;
+		imuCalibration calibration = {};
+		gyroBiasEstimate gyroBias = {};
+		gestureState gestures = {};
+		s_SceFQuaternion orientation = { 0.0f,0.0f,0.0f,1.0f };
+		s_SceFVector3 acceleration = { 0.0f,0.0f,0.0f }; // newest sample, g
+		s_SceFVector3 angularVelocity = { 0.0f,0.0f,0.0f }; // newest sample after the deadband, rad/s
+		s_SceFVector3 angularAcceleration = { 0.0f,0.0f,0.0f }; // smoothed, rad/s^2
+		double rotation[3] = {}; // angularVelocity integrated over every report, never reset
+		s_SceFVector3 gravity = { 0.0f,0.0f,0.0f }; // body frame, g, zero until the first sample
+		s_SceFVector3 lastAcceleration = { 0.0f,0.0f,0.0f }; // low passed for tilt correction
+		float eInt[3] = { 0.0f, 0.0f, 0.0f }; // tilt correction integral term, rad/s
+		uint8_t touch1Count = 0;
+		uint8_t touch2Count = 0;
+		uint8_t touch1LastCount = 0;
+		uint8_t touch2LastCount = 0;
+		uint8_t touch1LastIndex = 0;
+		uint8_t touch2LastIndex = 0;
+		alignas(CACHE_LINE_SIZE) dualsenseData::USBGetStateData dualsenseCurInputState = {};
 		dualshock4Data::USBGetStateData dualshock4CurInputState = {};
-		dualshock4Data::BTSetStateData dualshock4LastOutputState = {};
+
+		// Output, I/O thread only
+		alignas(CACHE_LINE_SIZE) dualsenseData::SetStateData dualsenseCurOutputState = {};
+		dualsenseData::SetStateData dualsenseLastOutputState = {};
 		dualshock4Data::BTSetStateData dualshock4CurOutputState = {};
+		dualshock4Data::BTSetStateData dualshock4LastOutputState = {};
 		dualshock4Data::ReportFeatureInDongleSetAudio dualshock4CurAudio = { 0xE0, 0, dualshock4Data::AudioOutput::Disabled };
 		dualshock4Data::ReportFeatureInDongleSetAudio dualshock4LastAudio = { 0xE0, 0, dualshock4Data::AudioOutput::Speaker };
+		trigger L2 = {};
+		trigger R2 = {};
+		uint8_t triggerMask = 0;
+
+		// Cold, written at bring-up
+		alignas(CACHE_LINE_SIZE) dualsenseData::ReportFeatureInVersion versionReport = {};
+		restoreTiming restore = {};
 		std::string macAddress = "";
 		std::string systemIdentifier = "";
 		std::string lastPath = "";
 		std::string id = "";
 		uint32_t idSize = 0;
-		trigger L2 = {};
-		trigger R2 = {};
-		uint8_t triggerMask = 0;
-		uint32_t lastSensorTimestamp = 0;
-		bool velocityDeadband = false;
-		bool motionSensorState = true;
-		bool tiltCorrection = false;
-		s_SceFQuaternion orientation = { 0.0f,0.0f,0.0f,1.0f };
-		s_SceFVector3 lastAcceleration = { 0.0f,0.0f,0.0f };
-		float eInt[3] = { 0.0f, 0.0f, 0.0f };
-		std::chrono::steady_clock::time_point lastUpdate = {};
-		float deltaTime = 0.0f;
-		uint8_t touch1Count = 0;
-		uint8_t touch2Count = 0;
-		uint8_t touch1LastCount = 0;
-		uint8_t touch2LastCount = 0;
-		uint8_t touch1LastIndex = 0;
-		uint8_t touch2LastIndex = 0;
-		bool started = false;
+
+		bool isLive() const {
+			return connection.load(std::memory_order_acquire) == connectionState::Live;
+		}
+
+		// Free for a bring-up to claim
+		bool isClaimable() const {
+			connectionState current = connection.load(std::memory_order_acquire);
+			return current == connectionState::Empty || current == connectionState::Lost || current == connectionState::Closed;
+		}
+
+		// Returns false if another thread moved the slot out of `from` first
+		bool transition(connectionState from, connectionState to) {
+			return connection.compare_exchange_strong(from, to, std::memory_order_seq_cst);
+		}
+
+		// I/O thread, brackets one pass over the slot. Flag first, state second, and the closing side does the
+		// opposite in waitIoIdle, so with seq_cst on both either the pass sees the slot gone or the closer sees the pass.
+		bool enterIo() {
+			ioBusy.store(true, std::memory_order_seq_cst);
+			if (connection.load(std::memory_order_seq_cst) == connectionState::Live) return true;
+
+			ioBusy.store(false, std::memory_order_release);
+			return false;
+		}
+
+		void leaveIo() {
+			ioBusy.store(false, std::memory_order_release);
+		}
+
+		// Called after taking the slot out of Live, before touching what the I/O thread uses. Never from the I/O thread.
+		void waitIoIdle() const {
+			while (ioBusy.load(std::memory_order_seq_cst)) {
+				std::this_thread::yield();
+			}
+		}
 	};
 
+	static_assert(alignof(controller) == CACHE_LINE_SIZE, "controller slots must start on a cache line");
+	static_assert(sizeof(controller) % CACHE_LINE_SIZE == 0, "controller slots must not share a cache line");
+
     void setPlayerLights(duaLibUtils::controller& controller, bool oldStyle);
     bool letGo(hid_device* handle, uint8_t deviceType, uint8_t connectionType);
     bool getHardwareVersion(hid_device* handle, dualsenseData::ReportFeatureInVersion& report);
     bool getMacAddress(hid_device* handle, std::string& outMac, uint32_t deviceId, uint8_t connectionType);
-    bool isValid(hid_device* handle);
+    bool openInputFd(duaLibUtils::controller& controller, const char* path);
+    void closeInputFd(duaLibUtils::controller& controller);
+    int readInputReport(duaLibUtils::controller& controller, unsigned char* buffer, size_t size, int timeoutMs = 0);
+    int64_t getTimeUs();
+    int64_t getThreadCpuTimeUs();
+    void trackReport(duaLibUtils::controller& controller, uint32_t deviceDeltaUs, uint32_t reportCount);
+    void applyCommands(duaLibUtils::controller& controller);
+    void trackRestore(duaLibUtils::controller& controller);
+    void publishStatistics(duaLibUtils::controller& controller);
+    void pushConnectionEvent(duaLibUtils::controller& controller, connectionState state);
+    int64_t predictNextReport(const duaLibUtils::controller& controller, int64_t nowUs);
+    void setThreadAffinity(uint32_t mask);
+    void setThreadScheduling(uint8_t policy, int8_t priority);
     bool GetID(const char* narrowPath, const char** ID, uint32_t* size);
 }
\ No newline at end of file
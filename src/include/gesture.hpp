@@ -0,0 +1,22 @@
+#pragma once
+#include <duaLib.h>
+#include <duaLibUtils.hpp>
+
+#define GESTURE_DEFAULT_SHAKE_THRESHOLD 1.5f // g
+#define GESTURE_DEFAULT_SHAKE_COUNT 3
+#define GESTURE_DEFAULT_SHAKE_WINDOW_US 250000
+#define GESTURE_DEFAULT_TAP_THRESHOLD 2.5f // g
+#define GESTURE_DEFAULT_TAP_MAX_US 30000
+#define GESTURE_DEFAULT_FLICK_THRESHOLD 10.0f // rad/s
+#define GESTURE_DEFAULT_FLICK_MAX_US 150000
+#define GESTURE_DEFAULT_TWIST_ANGLE 1.2f // rad
+#define GESTURE_DEFAULT_COOLDOWN_US 200000
+#define GESTURE_RELEASE_RATIO 0.5f // a stroke, spike or burst ends below this fraction of its threshold
+#define GESTURE_TWIST_DOMINANCE 2.0f // the twist axis has to spin this much faster than the other two
+#define GESTURE_TWIST_DECAY 4.0f // 1/s, an interrupted twist unwinds instead of adding up over minutes
+
+namespace duaLibUtils {
+	// Runs after updateMotion for every input report on the I/O thread, uses its gravity-free acceleration and
+	// angular velocity. deltaUs comes from the device clock.
+	void updateGestures(duaLibUtils::controller& controller, uint32_t deltaUs);
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#define HOTPLUG_FALLBACK_SCAN_MS 5000 // periodic rescan when uevents are available
+#define HOTPLUG_RETRY_MS 100
+#define HOTPLUG_RETRY_WINDOW_MS 1000 // how long a freshly added node keeps getting rescanned
+
+namespace duaLibUtils {
+	enum class hotplugAction : uint8_t {
+		None,
+		Add,
+		Remove
+	};
+
+	struct hotplugEvent {
+		hotplugAction action = hotplugAction::None;
+		std::string devnode = ""; // /dev/hidrawN, same as the path hidapi reports
+	};
+
+	// Kernel uevent listener for hidraw add/remove. Only does anything on Linux, elsewhere wait() just sleeps.
+	struct hotplugMonitor {
+		int socketFd = -1;
+		int wakeFd = -1;
+		std::mutex injectLock{};
+		std::vector<std::string> injected = {};
+	};
+
+	// Watcher thread bookkeeping between waits
+	struct hotplugQueue {
+		std::vector<std::string> pending = {}; // added nodes that aren't bound to a slot yet
+		int64_t retryUntilUs = 0;
+		int64_t nextScanUs = 0;
+	};
+
+	bool openHotplugMonitor(hotplugMonitor& monitor);
+	void closeHotplugMonitor(hotplugMonitor& monitor);
+	bool waitHotplugEvents(hotplugMonitor& monitor, int timeoutMs, std::vector<hotplugEvent>& events);
+	void injectUevent(hotplugMonitor& monitor, const char* buffer, size_t size);
+	void wakeHotplugMonitor(hotplugMonitor& monitor);
+	bool parseUevent(const char* buffer, size_t size, hotplugEvent& event);
+	void queueHotplugEvents(hotplugQueue& queue, const std::vector<hotplugEvent>& events, int64_t nowUs, std::vector<std::string>& removed);
+	void scheduleHotplugScan(hotplugQueue& queue, int64_t nowUs, int64_t fallbackUs, bool (*isBound)(const std::string& path));
+}
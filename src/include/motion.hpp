@@ -0,0 +1,62 @@
+#pragma once
+#include <duaLib.h>
+#include <duaLibUtils.hpp>
+
+#define ANGULAR_VELOCITY_DEADBAND_MIN 0.017453292
+#define DUALSENSE_CALIBRATION_REPORT 0x05
+#define DUALSHOCK4_CALIBRATION_REPORT_USB 0x02
+#define DUALSHOCK4_CALIBRATION_REPORT_BT 0x05
+#define MAX_MOTION_GAP_US 100000 // longer gaps between reports (first report, a stall) aren't integrated
+#define REST_ACCEL_VARIANCE 0.0001f // g^2, about 0.01 g of noise
+#define REST_GYRO_MAX 0.1f // rad/s, anything faster than ~6 deg/s is real motion not bias
+#define REST_SETTLE_US 500000 // still this long before the bias estimate follows
+#define REST_BIAS_MEMORY_US 300000000.0 // rest readings fade out over ~5 minutes
+#define REST_MIN_WEIGHT_US 100000.0 // rest time needed before the fit is used
+#define REST_MIN_TEMPERATURE_SPREAD 1.0 // temperature variance (sensor units^2) needed to fit a slope
+#define REST_MAX_EXTRAPOLATION 2.0 // standard deviations of the rest temperatures the fit may reach past their mean
+#define REST_STATS_SMOOTHING 0.05f // accelerometer mean/variance low pass per report
+#define ANGULAR_ACCELERATION_SMOOTHING 0.05f // per report
+#define STICK_VELOCITY_TIME_CONSTANT_US 40000.0f // low pass on the stick velocity, in time so the report rate doesn't matter
+#define STICK_VELOCITY_DEADBAND 0.00006f // units/us (60/s), what 1-2 LSB of noise leaves after the low pass
+#define MAX_PREDICTION_US 50000 // scePadReadStateAt never extrapolates further than this
+#define GRAVITY_CORRECTION_RATE 2.0f // 1/s, how fast the gravity estimate leans towards the accelerometer
+#define TILT_CORRECTION_KP 1.0f // Mahony proportional gain, 1/s
+#define TILT_CORRECTION_KI 0.02f // Mahony integral gain, 1/s^2
+#define TILT_ACCEL_TOLERANCE 0.15f // only trust the accelerometer within 15% of 1 g
+#define TILT_ACCEL_SMOOTHING 0.2f // accelerometer low pass per report, keeps rumble out of the correction
+
+namespace duaLibUtils {
+	// Factory calibration feature report. DS4 over BT answers with full input reports only after it was read once.
+	bool readImuCalibration(hid_device* handle, uint16_t productID, uint8_t connectionType, imuCalibration& calibration);
+	bool parseImuCalibration(const unsigned char* report, int size, uint16_t productID, uint8_t connectionType, imuCalibration& calibration);
+
+	// Runs once per input report on the I/O thread, deltaUs comes from the device clock
+	void updateMotion(duaLibUtils::controller& controller, const s_SceFVector3& acceleration, const s_SceFVector3& angularVelocity, float temperature, uint32_t deltaUs);
+
+	// Extrapolates a published state by `seconds`: constant angular acceleration for the gyro and orientation,
+	// constant velocity for the sticks
+	void predictState(publishedState& state, float seconds, bool motion);
+
+	// Per published report, `last` is the previous report's state elapsedUs ago
+	void trackStickVelocity(publishedState& state, const s_ScePadData& last, int64_t elapsedUs);
+
+	inline float reportTemperature(const dualsenseData::USBGetStateData& report) { return report.Temperature; }
+	inline float reportTemperature(const dualshock4Data::USBGetStateData& report) { return report.Temperture; }
+
+	template <typename State>
+	void updateMotion(duaLibUtils::controller& controller, const State& report, uint32_t deltaUs) {
+		const auto& c = controller.calibration;
+		s_SceFVector3 acceleration = {
+			(report.AccelerometerX - c.accelBias[0]) * c.accelScale[0],
+			(report.AccelerometerY - c.accelBias[1]) * c.accelScale[1],
+			(report.AccelerometerZ - c.accelBias[2]) * c.accelScale[2]
+		};
+		s_SceFVector3 angularVelocity = {
+			(report.AngularVelocityX - c.gyroBias[0]) * c.gyroScale[0],
+			(report.AngularVelocityY - c.gyroBias[1]) * c.gyroScale[1],
+			(report.AngularVelocityZ - c.gyroBias[2]) * c.gyroScale[2]
+		};
+
+		updateMotion(controller, acceleration, angularVelocity, reportTemperature(report), deltaUs);
+	}
+}
@@ -1 +1 @@
-bool ReadDualsense(duaLibUtils::controller& controller);
\ No newline at end of file
+bool ReadDualsense(duaLibUtils::controller& controller, int timeoutMs = 0);
\ No newline at end of file
@@ -1 +1 @@
-bool ReadDualshock4(duaLibUtils::controller& controller);
\ No newline at end of file
+bool ReadDualshock4(duaLibUtils::controller& controller, int timeoutMs = 0);
\ No newline at end of file
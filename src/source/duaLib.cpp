@@ -9,14 +9,24 @@
 #include <thread>       
 #include <chrono>      
 #include <cstring>    
+#include <cstdlib>
 #include <cmath>
 #include <shared_mutex>
+#include <condition_variable>
 #include <fstream>
 #include <iomanip> 
+#include <unordered_map>
+#include <unordered_set>
+#include <deque>
+#include <cwctype>
 
 #include <duaLibUtils.hpp>
 #include <readDualsense.hpp>
 #include <readDualshock4.hpp>
+#include <hotplug.hpp>
+#include <deviceTraits.hpp>
+#include <motion.hpp>
+#include <gesture.hpp>
 
 #define M_PI 3.14159265358979323846  
 
@@ -41,7 +51,16 @@
 #include <cstdlib>
 #endif
 
-#define ANGULAR_VELOCITY_DEADBAND_MIN 0.017453292
+#if defined(__linux__)
+#include <cerrno>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#endif
+
+#define BRINGUP_WORKER_COUNT MAX_CONTROLLER_COUNT
+#define REPORT_SPIN_US 50 // how long past the predicted arrival we keep spinning before falling back to polling
 
 struct device {
 	uint16_t Vendor = 0;
@@ -65,8 +84,24 @@ static std::atomic<bool> g_threadRunning = false;
 static std::atomic<bool> g_initialized = false;
 static std::atomic<bool> g_particularMode = false;
 static std::atomic<bool> g_allowBluetooth = false;
+static std::atomic<uint8_t> g_ioThreadMode = SCE_PAD_IO_THREAD_SHARED;
+static uint8_t g_ioSchedPolicy = SCE_PAD_IO_SCHED_DEFAULT;
+static int8_t g_ioPriority = 0;
+static uint32_t g_ioAffinityMask[MAX_CONTROLLER_COUNT] = {};
 static std::thread g_readThread;
 static std::thread g_watchThread;
+static std::thread g_ioThreads[MAX_CONTROLLER_COUNT];
+static std::mutex g_wakeMutex;
+static std::condition_variable g_wakeCondition; // idle per-controller threads wait on this
+static std::atomic<uint8_t> g_ioPolicy = SCE_PAD_IO_POLICY_BALANCED;
+static std::atomic<uint64_t> g_ioWakeups = 0;
+static std::atomic<int64_t> g_ioCpuTimeUs = 0;
+static int64_t g_initTimeUs = 0;
+static duaLibUtils::hotplugMonitor g_hotplug;
+static float g_wakeLatencyUs = 50.0f; // how late the OS wakes the reader past its deadline, reader thread only
+#if defined(__linux__)
+static int g_wakeFd = -1; // eventfd used to kick the reader out of poll() when the set of controllers changes
+#endif
 constexpr std::array<s_SceLightBar, 4> g_playerColors = { {
 	{  0, 0, 255 }, // Player 1 - Blue
 	{255,  0,   0 }, // Player 2 - Red
@@ -74,6 +109,215 @@ constexpr std::array<s_SceLightBar, 4> g_playerColors = { {
 	{255, 0, 255 }  // Player 4 - Pink
 } };
 
+static void wakeReader() {
+#if defined(__linux__)
+	if (g_wakeFd >= 0) {
+		uint64_t one = 1;
+		(void)write(g_wakeFd, &one, sizeof(one));
+	}
+#endif
+	{
+		std::lock_guard guard(g_wakeMutex);
+	}
+	g_wakeCondition.notify_all();
+}
+
+static void publishState(duaLibUtils::controller& controller);
+
+// Handles are sizeof(controller) * (slot + 1), so the slot decodes directly. Closed handles no longer match
+// their slot's sceHandle and get rejected.
+static duaLibUtils::controller* getController(int handle) {
+	constexpr int stride = static_cast<int>(sizeof(duaLibUtils::controller));
+	if (handle <= 0 || handle % stride != 0) return nullptr;
+
+	int index = handle / stride - 1;
+	if (index >= MAX_CONTROLLER_COUNT) return nullptr;
+
+	auto& controller = g_controllers[index];
+	if (controller.sceHandle != static_cast<uint32_t>(handle)) return nullptr;
+
+	return &controller;
+}
+
+static void readController(duaLibUtils::controller& controller, int timeoutMs = 0) {
+	if (!controller.opened || !controller.enterIo()) return;
+
+	uint64_t reports = controller.timing.reports;
+
+	if (controller.deviceType == DUALSENSE) {
+		ReadDualsense(controller, timeoutMs);
+	}
+	else if (controller.deviceType == DUALSHOCK4) {
+		ReadDualshock4(controller, timeoutMs);
+	}
+
+	if (controller.timing.reports != reports) {
+		publishState(controller);
+		duaLibUtils::publishStatistics(controller);
+	}
+
+	controller.leaveIo();
+}
+
+// Deadline (host us) for the next pass over the controllers, INT64_MAX when nothing needs a timed wakeup.
+// Balanced/hybrid sleep until just before the earliest predicted report, spin briefly around it and fall back
+// to polling every fallbackUs while a report is late or the cadence isn't known yet. Blocking never spins,
+// busy poll never sleeps. Controllers we can block on only take part in hybrid mode.
+static int64_t nextReadDeadline(int64_t now, int64_t fallbackUs) {
+	uint8_t policy = g_ioPolicy;
+	if (policy == SCE_PAD_IO_POLICY_BUSY_POLL) return now;
+
+	int64_t deadline = INT64_MAX;
+	int64_t guard = static_cast<int64_t>(g_wakeLatencyUs * 2.0f) + 10;
+
+	for (auto& controller : g_controllers) {
+		if (!controller.opened || !controller.isLive()) continue;
+
+		bool polled = controller.inputFd < 0;
+		if (!polled && policy != SCE_PAD_IO_POLICY_HYBRID) continue;
+
+		int64_t expected = duaLibUtils::predictNextReport(controller, now);
+		int64_t wake = polled ? now + fallbackUs : INT64_MAX;
+
+		if (policy == SCE_PAD_IO_POLICY_BLOCKING) {
+			wake = expected != 0 ? std::max(now, expected + REPORT_SPIN_US) : now + 1000;
+		}
+		else if (expected != 0 && now < expected + REPORT_SPIN_US) {
+			wake = now < expected - guard ? expected - guard : now;
+		}
+
+		deadline = std::min(deadline, wake);
+	}
+
+	return deadline;
+}
+
+static void trackWakeLatency(int64_t deadline) {
+	float late = static_cast<float>(std::clamp<int64_t>(duaLibUtils::getTimeUs() - deadline, 0, 2000));
+	g_wakeLatencyUs += (late - g_wakeLatencyUs) / 16.0f;
+}
+
+// Per I/O thread wakeup and CPU time bookkeeping for scePadGetIoStatistics, flushed every 100ms
+struct ioAccounting {
+	int64_t lastFlushUs = 0;
+	int64_t lastCpuUs = 0;
+	uint64_t wakeups = 0;
+
+	ioAccounting() : lastFlushUs(duaLibUtils::getTimeUs()), lastCpuUs(duaLibUtils::getThreadCpuTimeUs()) {}
+
+	void wakeup() {
+		if ((++wakeups & 63) != 0 && g_ioPolicy == SCE_PAD_IO_POLICY_BUSY_POLL) return;
+
+		int64_t now = duaLibUtils::getTimeUs();
+		if (now - lastFlushUs < 100000) return;
+
+		int64_t cpu = duaLibUtils::getThreadCpuTimeUs();
+		g_ioCpuTimeUs += cpu - lastCpuUs;
+		g_ioWakeups += wakeups;
+		lastCpuUs = cpu;
+		lastFlushUs = now;
+		wakeups = 0;
+	}
+};
+
+// Busy polling without an explicit affinity pins itself to the last CPU so it doesn't fight the game's threads
+static uint32_t ioAffinity(int index) {
+	uint32_t mask = g_ioAffinityMask[index];
+
+	if (mask == 0 && g_ioPolicy == SCE_PAD_IO_POLICY_BUSY_POLL) {
+		unsigned cpus = std::thread::hardware_concurrency();
+		if (cpus > 1 && cpus <= 32) mask = 1u << (cpus - 1);
+	}
+
+	return mask;
+}
+
+#if defined(__linux__)
+// Blocks on every opened hidraw node plus the wake eventfd and only runs the read functions when a report is queued.
+// Controllers without a hidraw node (libusb backend) are polled on an absolute timerfd deadline around their predicted next report.
+int readFunc() {
+	duaLibUtils::setThreadAffinity(ioAffinity(0));
+	duaLibUtils::setThreadScheduling(g_ioSchedPolicy, g_ioPriority);
+
+	int timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	bool timerArmed = false;
+	pollfd fds[MAX_CONTROLLER_COUNT + 2] = {};
+	int owner[MAX_CONTROLLER_COUNT + 2] = {};
+	ioAccounting accounting;
+
+	while (g_threadRunning) {
+		nfds_t count = 0;
+
+		fds[count].fd = g_wakeFd;
+		fds[count].events = POLLIN;
+		owner[count++] = -1;
+
+		fds[count].fd = timerFd;
+		fds[count].events = POLLIN;
+		owner[count++] = -1;
+
+		for (int i = 0; i < MAX_CONTROLLER_COUNT; i++) {
+			auto& controller = g_controllers[i];
+
+			if (!controller.opened || !controller.isLive() || controller.inputFd < 0) continue;
+
+			fds[count].fd = controller.inputFd;
+			fds[count].events = POLLIN;
+			owner[count++] = i;
+		}
+
+		int64_t now = duaLibUtils::getTimeUs();
+		int64_t deadline = nextReadDeadline(now, 100);
+		timespec spin = { 0, 0 };
+		itimerspec timer = {};
+
+		bool spinning = deadline <= now;
+		bool arm = !spinning && deadline != INT64_MAX;
+		if (arm) {
+			timer.it_value.tv_sec = deadline / 1000000;
+			timer.it_value.tv_nsec = (deadline % 1000000) * 1000;
+		}
+		if (arm || timerArmed) {
+			timerfd_settime(timerFd, TFD_TIMER_ABSTIME, &timer, nullptr); // all zero disarms it
+			timerArmed = arm;
+		}
+
+		int res = ppoll(fds, count, spinning ? &spin : nullptr, nullptr);
+		accounting.wakeup();
+		if (res < 0 && errno != EINTR) {
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+			continue;
+		}
+
+		if (fds[0].revents & POLLIN) {
+			uint64_t value = 0;
+			(void)read(g_wakeFd, &value, sizeof(value));
+		}
+
+		if (fds[1].revents & POLLIN) {
+			uint64_t value = 0;
+			(void)read(timerFd, &value, sizeof(value));
+			trackWakeLatency(deadline);
+		}
+
+		// POLLHUP/POLLERR go through the read as well, it fails with EIO/ENODEV and marks the controller lost
+		for (nfds_t i = 2; i < count; i++) {
+			if (fds[i].revents) {
+				readController(g_controllers[owner[i]]);
+			}
+		}
+
+		for (auto& controller : g_controllers) {
+			if (controller.opened && controller.isLive() && controller.inputFd < 0) {
+				readController(controller);
+			}
+		}
+	}
+
+	close(timerFd);
+	return 0;
+}
+#else
 int readFunc() {
 #if defined(_WIN32) || defined(_WIN64)
 	SetPriorityClass(GetCurrentProcess(), HIGH_PRIORITY_CLASS);
@@ -87,173 +331,454 @@ int readFunc() {
 	HANDLE hTimer = CreateWaitableTimerEx(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
 	LARGE_INTEGER liDueTime;
 	liDueTime.QuadPart = -5000LL;
+	constexpr int64_t fallbackUs = 500;
+#else
+	constexpr int64_t fallbackUs = 100;
 #endif
+	duaLibUtils::setThreadAffinity(ioAffinity(0));
+	duaLibUtils::setThreadScheduling(g_ioSchedPolicy, g_ioPriority);
+	ioAccounting accounting;
 
 	while (g_threadRunning) {
 		for (auto& controller : g_controllers) {
-			if (controller.valid && controller.opened && controller.deviceType == DUALSENSE) {
-				ReadDualsense(controller);
-			}
-			else if (controller.valid && controller.opened && controller.deviceType == DUALSHOCK4) {
-				ReadDualshock4(controller);
-			}
-			else if (!controller.valid && controller.opened) {
-				std::shared_lock guard(controller.lock);
-				controller.wasDisconnected = true;
-			}
+			readController(controller);
+		}
+
+		// Sleep until just before the next predicted report instead of polling blindly
+		int64_t now = duaLibUtils::getTimeUs();
+		int64_t deadline = nextReadDeadline(now, fallbackUs);
+		if (deadline == INT64_MAX) {
+			// Nothing connected, wait for scePadOpen or the watcher
+			std::unique_lock guard(g_wakeMutex);
+			g_wakeCondition.wait_for(guard, std::chrono::milliseconds(100));
+			accounting.wakeup();
+			continue;
+		}
+		if (deadline <= now) {
+			if (g_ioPolicy != SCE_PAD_IO_POLICY_BUSY_POLL) std::this_thread::yield();
+			accounting.wakeup();
+			continue;
 		}
 
 	#if defined(_WIN32) || defined(_WIN64)
+		liDueTime.QuadPart = -(deadline - now) * 10LL; // relative, in 100ns units
 		SetWaitableTimer(hTimer, &liDueTime, 0, NULL, NULL, 0);
 		WaitForSingleObject(hTimer, INFINITE);
 	#else
-		std::this_thread::sleep_for(std::chrono::microseconds(100));
+		std::this_thread::sleep_until(std::chrono::steady_clock::time_point(std::chrono::microseconds(deadline)));
 	#endif
+		accounting.wakeup();
+		trackWakeLatency(deadline);
 	}
 	return 0;
 }
+#endif
 
-int watchFunc() {
+// SCE_PAD_IO_THREAD_PER_CONTROLLER: every slot is serviced by its own thread blocking on its own device,
+// so a stalled hid_write on one link can't delay the others. Busy poll never blocks in the read.
+int controllerIoFunc(int index) {
 #if defined(_WIN32) || defined(_WIN64)
 	SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_HIGHEST);
+	timeBeginPeriod(1);
 #endif
+	duaLibUtils::setThreadAffinity(ioAffinity(index));
+	duaLibUtils::setThreadScheduling(g_ioSchedPolicy, g_ioPriority);
+
+	auto& controller = g_controllers[index];
+	ioAccounting accounting;
 
 	while (g_threadRunning) {
-		std::this_thread::sleep_for(std::chrono::seconds(1));
-
-		for (int j = 0; j < DEVICE_COUNT; ++j) {
-			hid_device_info* head = hid_enumerate(
-				g_deviceList.devices[j].Vendor,
-				g_deviceList.devices[j].Device
-			);
-
-			for (hid_device_info* info = head; info; info = info->next) {
-				std::string newMac;
-				bool already = false;
-				bool invalid = false;
-				bool started = false;
-
-				hid_device* handle = hid_open_path(info->path);
-
-				if (info->bus_type == HID_API_BUS_BLUETOOTH && !g_allowBluetooth) {
-					hid_close(handle);
-					goto skipController;
-				}
-
-				if (!handle) continue;
-
-				if (duaLibUtils::getMacAddress(handle, newMac, g_deviceList.devices[j].Device, info->bus_type)) {
-					for (int k = 0; k < MAX_CONTROLLER_COUNT; ++k) {
-						std::shared_lock guard(g_controllers[k].lock);
-						if (g_controllers[k].macAddress == newMac && duaLibUtils::isValid(g_controllers[k].handle)) {
-							already = true;
-							hid_close(handle);
-							break;
-						}
-					}
-
-					// Restore half valid controllers
-					for (auto& controller : g_controllers) {				
-						if (duaLibUtils::isValid(controller.handle) && !controller.valid) {
-							std::shared_lock guard(controller.lock);
-							controller.valid = true;
-						}
-					}
-
-					if (!already) {
-						for (auto& controller : g_controllers) {
-							bool valid;
-							{
-								std::shared_lock guard(controller.lock);
-								valid = duaLibUtils::isValid(controller.handle);
-							}
-
-							if (!valid) {
-
-								std::shared_lock guard(controller.lock);
-								controller.started = true;
-								controller.handle = handle;
-								controller.macAddress = newMac;
-								controller.connectionType = info->bus_type;
-								controller.valid = true;
-								controller.failedReadCount = 0;
-								controller.lastPath = info->path;
-								controller.productID = g_deviceList.devices[j].Device;
-								hid_set_nonblocking(controller.handle, true);
-
-								const char* id = {};
-								uint32_t size = 0;
-								duaLibUtils::GetID(info->path, &id, &size);
-
-							#if defined(_WIN32) || defined(_WIN64)
-								controller.id = id;
-								controller.idSize = size;
-							#endif
-
-								uint16_t dev = g_deviceList.devices[j].Device;
-
-								if (dev == DUALSENSE_DEVICE_ID || dev == DUALSENSE_EDGE_DEVICE_ID) { controller.deviceType = DUALSENSE; }
-								else if (dev == DUALSHOCK4_DEVICE_ID || dev == DUALSHOCK4V2_DEVICE_ID || dev == DUALSHOCK4_WIRELESS_ADAPTOR_ID) { controller.deviceType = DUALSHOCK4; }
-
-								if (controller.deviceType == DUALSENSE && info->bus_type == HID_API_BUS_BLUETOOTH) {
-									duaLibUtils::getHardwareVersion(controller.handle, controller.versionReport);
-									dualsenseData::ReportOut31 report = {};
-
-									report.Data.ReportID = 0x31;
-									report.Data.flag = 2;
-									report.Data.State.EnableRumbleEmulation = true;
-									report.Data.State.UseRumbleNotHaptics = true;
-									report.Data.State.AllowRightTriggerFFB = true;
-									report.Data.State.AllowLeftTriggerFFB = true;
-									report.Data.State.AllowLedColor = true;
-									report.Data.State.AllowColorLightFadeAnimation = true;
-									report.Data.State.lightFadeAnimation = dualsenseData::LightFadeAnimation::FadeOut;
-									report.Data.State.ResetLights = true;
-									report.Data.State.LeftTriggerFFB[0] = (uint8_t)TriggerEffectType::Off;
-									report.Data.State.RightTriggerFFB[0] = (uint8_t)TriggerEffectType::Off;
-
-									uint32_t crc = compute(report.CRC.Buff, sizeof(report) - 4);
-									report.CRC.CRC = crc;
-
-									hid_write(controller.handle, reinterpret_cast<unsigned char*>(&report), sizeof(report));
-								}
-								else if (controller.deviceType == DUALSHOCK4 && info->bus_type == HID_API_BUS_BLUETOOTH) {
-									dualshock4Data::ReportOut11 report = {};
-									report.Data.ReportID = 0x11;
-									report.Data.EnableHID = 1;
-									report.Data.AllowRed = 0;
-									report.Data.AllowGreen = 0;
-									report.Data.AllowBlue = 0;
-									report.Data.EnableAudio = 0;
-									report.Data.State.LedRed = 0;
-									report.Data.State.LedGreen = 0;
-									report.Data.State.LedBlue = 0;
-									report.Data.State.EnableLedUpdate = true;
-
-									uint32_t crc = compute(report.CRC.Buff, sizeof(report) - 4);
-									report.CRC.CRC = crc;
-
-									int res = hid_write(controller.handle, reinterpret_cast<unsigned char*>(&report), sizeof(report));
-
-									unsigned char fullReportFeature[78];
-									fullReportFeature[0] = 0x05;
-									hid_get_feature_report(controller.handle, fullReportFeature, sizeof(fullReportFeature)); // <-- send this to receive full report
-								}
-
-								break;
-							}
-						}
-					}
-
-				skipController:
-					{}
-				}
+		if (!controller.opened || !controller.isLive()) {
+			std::unique_lock guard(g_wakeMutex);
+			g_wakeCondition.wait_for(guard, std::chrono::milliseconds(100));
+			accounting.wakeup();
+			continue;
+		}
+
+		readController(controller, g_ioPolicy == SCE_PAD_IO_POLICY_BUSY_POLL ? 0 : 50);
+		accounting.wakeup();
+	}
+	return 0;
+}
+
+// Devices seen by the last enumeration pass, keyed by path. Only touched by the watcher thread.
+// A path that's already bound to a slot, or whose serial number names a MAC that is, never gets opened again.
+struct knownDevice {
+	std::string mac = "";
+	bool present = false;
+};
+static std::unordered_map<std::string, knownDevice> g_knownDevices;
+
+static int findDevice(uint16_t productID) {
+	for (int j = 0; j < DEVICE_COUNT; ++j) {
+		if (g_deviceList.devices[j].Device == productID) return j;
+	}
+	return -1;
+}
+
+// hidapi reports the MAC as the serial number on most backends (hidraw HID_UNIQ, BT on Windows/macOS)
+static std::string macFromSerial(const wchar_t* serial) {
+	if (!serial) return "";
+
+	std::string digits;
+	for (const wchar_t* c = serial; *c; c++) {
+		if (*c == L':' || *c == L'-') continue;
+		if (!iswxdigit(*c) || digits.size() == 12) return "";
+		digits += static_cast<char>(toupper(static_cast<int>(*c)));
+	}
+	if (digits.size() != 12) return "";
+
+	std::string mac;
+	for (size_t i = 0; i < 12; i += 2) {
+		if (i) mac += ':';
+		mac += digits.substr(i, 2);
+	}
+	return mac;
+}
+
+static bool isPathBound(const std::string& path) {
+	for (auto& controller : g_controllers) {
+		std::shared_lock guard(controller.lock);
+		if (controller.isLive() && controller.lastPath == path) return true;
+	}
+	return false;
+}
+
+static bool isMacBound(const std::string& mac) {
+	if (mac.empty()) return false;
+
+	for (auto& controller : g_controllers) {
+		std::shared_lock guard(controller.lock);
+		if (controller.isLive() && controller.macAddress == mac) return true;
+	}
+	return false;
+}
+
+// Factory IMU calibration by MAC, so a reconnecting pad doesn't have to be asked again
+static std::mutex g_calibrationMutex;
+static std::unordered_map<std::string, duaLibUtils::imuCalibration> g_calibrations;
+
+static bool cachedCalibration(const std::string& mac, duaLibUtils::imuCalibration& calibration) {
+	std::lock_guard lock(g_calibrationMutex);
+	auto it = g_calibrations.find(mac);
+	if (it == g_calibrations.end()) return false;
+
+	calibration = it->second;
+	return true;
+}
+
+static void cacheCalibration(const std::string& mac, const duaLibUtils::imuCalibration& calibration) {
+	std::lock_guard lock(g_calibrationMutex);
+	g_calibrations[mac] = calibration;
+}
+
+// Bring-up pool. The watcher queues paths, the workers open them and claim slots under g_bringUpMutex.
+struct bringUpJob {
+	std::string path = "";
+	uint16_t productID = 0;
+	uint8_t busType = 0;
+	int64_t discoveredUs = 0;
+};
+static std::mutex g_bringUpMutex;
+static std::condition_variable g_bringUpCondition;
+static std::deque<bringUpJob> g_bringUpQueue;
+static std::unordered_set<std::string> g_bringUpPaths;        // queued or being brought up
+static std::string g_bringUpMacs[MAX_CONTROLLER_COUNT] = {};  // MACs being brought up, by the slot they claimed
+static std::thread g_bringUpThreads[BRINGUP_WORKER_COUNT];
+
+// A pad that comes back goes to the slot it left, so the game keeps its handle and the slot's whole output state
+// (lightbar, trigger effects, audio, vibration mode) gets replayed to it. New pads prefer slots a game opened.
+// Call with g_bringUpMutex held.
+static int findFreeSlot(const std::string& mac) {
+	int waiting = -1;
+	int taken = -1;
+	int unopened = -1;
+
+	for (int i = 0; i < MAX_CONTROLLER_COUNT; i++) {
+		auto& controller = g_controllers[i];
+		std::shared_lock guard(controller.lock);
+
+		if (!controller.isClaimable()) continue;
+		if (controller.macAddress == mac) return i;
+
+		if (!controller.opened) {
+			if (unopened < 0) unopened = i;
+		}
+		else if (controller.macAddress.empty()) {
+			if (waiting < 0) waiting = i;
+		}
+		else if (taken < 0) {
+			taken = i;
+		}
+	}
+
+	return waiting >= 0 ? waiting : taken >= 0 ? taken : unopened;
+}
+
+// Opens a discovered device, claims a slot for it and sends the init reports. Runs on the bring-up pool so one
+// slow BT pad doesn't hold up the others.
+static void bringUpController(const bringUpJob& job) {
+	std::string newMac;
+	hid_device* handle = hid_open_path(job.path.c_str());
+
+	if (!handle) return;
+
+	if (!duaLibUtils::getMacAddress(handle, newMac, job.productID, job.busType)) {
+		hid_close(handle);
+		return;
+	}
+
+	int slot = -1;
+	auto claimed = duaLibUtils::connectionState::Opening;
+	{
+		std::lock_guard lock(g_bringUpMutex);
+		bool already = false;
+
+		for (int k = 0; k < MAX_CONTROLLER_COUNT; ++k) {
+			std::shared_lock guard(g_controllers[k].lock);
+			if ((g_controllers[k].macAddress == newMac && g_controllers[k].isLive()) || g_bringUpMacs[k] == newMac) {
+				already = true;
+				break;
 			}
+		}
 
-			hid_free_enumeration(head);
+		if (!already) {
+			slot = findFreeSlot(newMac);
 		}
 
-		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		if (slot >= 0) {
+			auto& controller = g_controllers[slot];
+			std::shared_lock guard(controller.lock);
+
+			if (controller.macAddress == newMac) claimed = duaLibUtils::connectionState::Reconnecting;
+			controller.connection.store(claimed, std::memory_order_release);
+			duaLibUtils::pushConnectionEvent(controller, claimed);
+			g_bringUpMacs[slot] = newMac;
+		}
+	}
+
+	if (slot < 0) {
+		hid_close(handle);
+		return;
+	}
+
+	{
+		auto& controller = g_controllers[slot];
+		controller.waitIoIdle(); // the claim took it out of Live, a pass that started before may still be reading
+
+		// Exclusive while the slot's identity changes, the other workers and the getters read these strings
+		std::unique_lock guard(controller.lock);
+		if (controller.handle) {
+			hid_close(controller.handle);
+		}
+		controller.handle = handle;
+		controller.macAddress = newMac;
+		controller.connectionType = job.busType;
+		controller.failedReadCount = 0;
+		controller.wasDisconnected = true; // first report after bring-up replays the whole output state
+		controller.state.clear();
+		controller.restore.startUs = job.discoveredUs;
+		controller.restore.reconnects += claimed == duaLibUtils::connectionState::Reconnecting ? 1 : 0;
+		controller.lastPath = job.path;
+		controller.productID = job.productID;
+		hid_set_nonblocking(controller.handle, true);
+		duaLibUtils::openInputFd(controller, job.path.c_str());
+
+		const char* id = {};
+		uint32_t size = 0;
+		duaLibUtils::GetID(job.path.c_str(), &id, &size);
+
+	#if defined(_WIN32) || defined(_WIN64)
+		controller.id = id;
+		controller.idSize = size;
+	#endif
+
+		uint16_t dev = job.productID;
+
+		if (dev == DUALSENSE_DEVICE_ID || dev == DUALSENSE_EDGE_DEVICE_ID) { controller.deviceType = DUALSENSE; }
+		else if (dev == DUALSHOCK4_DEVICE_ID || dev == DUALSHOCK4V2_DEVICE_ID || dev == DUALSHOCK4_WIRELESS_ADAPTOR_ID) { controller.deviceType = DUALSHOCK4; }
+
+		controller.calibration = {};
+		controller.gyroBias = {};
+		controller.gestures = {};
+		controller.gestureConfigChanged.store(true, std::memory_order_release); // reload the config into the fresh state
+
+		// The init reports can take a while over BT, don't hold the getters off for them
+		guard.unlock();
+		std::shared_lock sharedGuard(controller.lock);
+		bool calibrated = cachedCalibration(newMac, controller.calibration);
+
+		if (controller.deviceType == DUALSENSE && job.busType == HID_API_BUS_BLUETOOTH) {
+			duaLibUtils::getHardwareVersion(controller.handle, controller.versionReport);
+			dualsenseData::ReportOut31 report = {};
+
+			report.Data.ReportID = 0x31;
+			report.Data.flag = 2;
+			report.Data.State.EnableRumbleEmulation = true;
+			report.Data.State.UseRumbleNotHaptics = true;
+			report.Data.State.AllowRightTriggerFFB = true;
+			report.Data.State.AllowLeftTriggerFFB = true;
+			report.Data.State.AllowLedColor = true;
+			report.Data.State.AllowColorLightFadeAnimation = true;
+			report.Data.State.lightFadeAnimation = dualsenseData::LightFadeAnimation::FadeOut;
+			report.Data.State.ResetLights = true;
+			report.Data.State.LeftTriggerFFB[0] = (uint8_t)TriggerEffectType::Off;
+			report.Data.State.RightTriggerFFB[0] = (uint8_t)TriggerEffectType::Off;
+
+			uint32_t crc = compute(report.CRC.Buff, sizeof(report) - 4);
+			report.CRC.CRC = crc;
+
+			hid_write(controller.handle, reinterpret_cast<unsigned char*>(&report), sizeof(report));
+		}
+		else if (controller.deviceType == DUALSHOCK4 && job.busType == HID_API_BUS_BLUETOOTH) {
+			dualshock4Data::ReportOut11 report = {};
+			report.Data.ReportID = 0x11;
+			report.Data.EnableHID = 1;
+			report.Data.AllowRed = 0;
+			report.Data.AllowGreen = 0;
+			report.Data.AllowBlue = 0;
+			report.Data.EnableAudio = 0;
+			report.Data.State.LedRed = 0;
+			report.Data.State.LedGreen = 0;
+			report.Data.State.LedBlue = 0;
+			report.Data.State.EnableLedUpdate = true;
+
+			uint32_t crc = compute(report.CRC.Buff, sizeof(report) - 4);
+			report.CRC.CRC = crc;
+
+			int res = hid_write(controller.handle, reinterpret_cast<unsigned char*>(&report), sizeof(report));
+
+			unsigned char fullReportFeature[78];
+			fullReportFeature[0] = 0x05;
+			res = hid_get_feature_report(controller.handle, fullReportFeature, sizeof(fullReportFeature)); // <-- send this to receive full report
+
+			if (!calibrated && duaLibUtils::parseImuCalibration(fullReportFeature, res, job.productID, job.busType, controller.calibration)) {
+				cacheCalibration(newMac, controller.calibration);
+				calibrated = true;
+			}
+		}
+
+		if (!calibrated && duaLibUtils::readImuCalibration(controller.handle, job.productID, job.busType, controller.calibration)) {
+			cacheCalibration(newMac, controller.calibration);
+		}
+
+		// Only now, so the replay can't race the init reports above. scePadTerminate may have closed the slot meanwhile.
+		if (!controller.transition(claimed, duaLibUtils::connectionState::Live)) {
+			sharedGuard.unlock();
+			std::unique_lock closeGuard(controller.lock);
+			duaLibUtils::closeInputFd(controller);
+			hid_close(controller.handle);
+			controller.handle = 0;
+		}
+		else {
+			duaLibUtils::pushConnectionEvent(controller, duaLibUtils::connectionState::Live);
+		}
+	}
+
+	{
+		std::lock_guard lock(g_bringUpMutex);
+		g_bringUpMacs[slot] = "";
+	}
+	wakeReader();
+}
+
+int bringUpFunc() {
+	while (g_threadRunning) {
+		bringUpJob job;
+		{
+			std::unique_lock lock(g_bringUpMutex);
+			g_bringUpCondition.wait_for(lock, std::chrono::milliseconds(100), [] { return !g_bringUpQueue.empty() || !g_threadRunning; });
+			if (g_bringUpQueue.empty()) continue;
+
+			job = std::move(g_bringUpQueue.front());
+			g_bringUpQueue.pop_front();
+		}
+
+		bringUpController(job);
+
+		std::lock_guard lock(g_bringUpMutex);
+		g_bringUpPaths.erase(job.path);
+	}
+	return 0;
+}
+
+// One enumeration pass over every Sony device. Anything not bound to a slot yet is handed to the bring-up pool,
+// the watcher itself never waits on a device.
+static void scanControllers() {
+	hid_device_info* head = hid_enumerate(VENDOR_ID, 0);
+
+	for (auto& [path, known] : g_knownDevices) {
+		known.present = false;
+	}
+
+	for (hid_device_info* info = head; info; info = info->next) {
+		int j = findDevice(info->product_id);
+		if (j < 0 || !info->path) continue;
+		if (info->bus_type == HID_API_BUS_BLUETOOTH && !g_allowBluetooth) continue;
+
+		auto& known = g_knownDevices[info->path];
+		known.present = true;
+		if (known.mac.empty()) {
+			known.mac = macFromSerial(info->serial_number);
+		}
+
+		if (isPathBound(info->path) || isMacBound(known.mac)) continue;
+
+		std::lock_guard lock(g_bringUpMutex);
+		if (!g_bringUpPaths.insert(info->path).second) continue; // already queued or in progress
+
+		g_bringUpQueue.push_back({ info->path, g_deviceList.devices[j].Device, static_cast<uint8_t>(info->bus_type), duaLibUtils::getTimeUs() });
+		g_bringUpCondition.notify_one();
+	}
+
+	hid_free_enumeration(head);
+	std::erase_if(g_knownDevices, [](const auto& entry) { return !entry.second.present; });
+}
+
+// Marks the controller behind a removed hidraw node as gone right away instead of waiting for its reads to fail
+static void controllerRemoved(const std::string& path) {
+	for (auto& controller : g_controllers) {
+		std::shared_lock guard(controller.lock);
+
+		if (controller.lastPath != path) continue;
+
+		if (controller.transition(duaLibUtils::connectionState::Live, duaLibUtils::connectionState::Lost)) {
+			duaLibUtils::pushConnectionEvent(controller, duaLibUtils::connectionState::Lost);
+		}
+	}
+	wakeReader();
+}
+
+// Brings controllers up as soon as their hidraw node shows up. The periodic scan only stays as a fallback
+// for backends without uevents (libusb, Windows, macOS) or a socket we couldn't open.
+int watchFunc() {
+#if defined(_WIN32) || defined(_WIN64)
+	SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_HIGHEST);
+#endif
+
+	bool hotplug = g_hotplug.socketFd >= 0;
+	int64_t fallbackUs = (hotplug ? HOTPLUG_FALLBACK_SCAN_MS : 1100) * 1000LL;
+	duaLibUtils::hotplugQueue queue = {};
+	queue.nextScanUs = duaLibUtils::getTimeUs() + (hotplug ? 0 : 1000000);
+	std::vector<duaLibUtils::hotplugEvent> events;
+	std::vector<std::string> removed;
+
+	while (g_threadRunning) {
+		int64_t now = duaLibUtils::getTimeUs();
+
+		if (now >= queue.nextScanUs) {
+			scanControllers();
+			now = duaLibUtils::getTimeUs();
+			duaLibUtils::scheduleHotplugScan(queue, now, fallbackUs, isPathBound);
+		}
+
+		int timeoutMs = static_cast<int>(std::clamp<int64_t>((queue.nextScanUs - now + 999) / 1000, 0, 1000));
+		if (!duaLibUtils::waitHotplugEvents(g_hotplug, timeoutMs, events)) continue;
+
+		duaLibUtils::queueHotplugEvents(queue, events, duaLibUtils::getTimeUs(), removed);
+		for (auto& path : removed) {
+			controllerRemoved(path);
+		}
 	}
 
 	return 0;
@@ -280,11 +805,43 @@ int scePadInit3(s_ScePadInitParam* param) {
 		}
 
 		g_allowBluetooth = param->allowBT;
+		g_ioThreadMode = param->ioThreadMode;
+		g_ioSchedPolicy = param->ioSchedPolicy;
+		g_ioPriority = param->ioPriority;
+		for (int i = 0; i < MAX_CONTROLLER_COUNT; i++) {
+			g_ioAffinityMask[i] = param->ioAffinityMask[i];
+		}
+		g_ioPolicy = param->ioPolicy <= SCE_PAD_IO_POLICY_BLOCKING ? param->ioPolicy : SCE_PAD_IO_POLICY_BALANCED;
+		if (const char* policy = std::getenv("DUALIB_IO_POLICY")) {
+			if (!strcmp(policy, "balanced")) g_ioPolicy = SCE_PAD_IO_POLICY_BALANCED;
+			else if (!strcmp(policy, "busy")) g_ioPolicy = SCE_PAD_IO_POLICY_BUSY_POLL;
+			else if (!strcmp(policy, "hybrid")) g_ioPolicy = SCE_PAD_IO_POLICY_HYBRID;
+			else if (!strcmp(policy, "blocking")) g_ioPolicy = SCE_PAD_IO_POLICY_BLOCKING;
+		}
+		g_ioWakeups = 0;
+		g_ioCpuTimeUs = 0;
+		g_initTimeUs = duaLibUtils::getTimeUs();
+	#if defined(__linux__)
+		if (g_wakeFd < 0) {
+			g_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		}
+	#endif
+		if (g_hotplug.socketFd < 0) {
+			duaLibUtils::openHotplugMonitor(g_hotplug);
+		}
 		g_threadRunning = true;
-		g_readThread = std::thread(readFunc);
+		if (g_ioThreadMode == SCE_PAD_IO_THREAD_PER_CONTROLLER) {
+			for (int i = 0; i < MAX_CONTROLLER_COUNT; i++) {
+				g_ioThreads[i] = std::thread(controllerIoFunc, i);
+			}
+		}
+		else {
+			g_readThread = std::thread(readFunc);
+		}
+		for (auto& thread : g_bringUpThreads) {
+			thread = std::thread(bringUpFunc);
+		}
 		g_watchThread = std::thread(watchFunc);
-		g_readThread.detach();
-		g_watchThread.detach();
 		g_initialized = true;
 	}
 
@@ -296,25 +853,51 @@ int scePadTerminate(void) {
 	g_threadRunning = false;
 	g_initialized = false;
 
+	// Nothing may touch the slots or the wake eventfd while they're torn down
+	duaLibUtils::wakeHotplugMonitor(g_hotplug);
+	if (g_watchThread.joinable()) {
+		g_watchThread.join();
+	}
+	{
+		std::lock_guard lock(g_bringUpMutex);
+		g_bringUpCondition.notify_all();
+	}
+	for (auto& thread : g_bringUpThreads) {
+		if (thread.joinable()) thread.join();
+	}
+	g_bringUpQueue.clear();
+	g_bringUpPaths.clear();
+	g_knownDevices.clear();
+
+	wakeReader();
+	for (auto& thread : g_ioThreads) {
+		if (thread.joinable()) thread.join();
+	}
+	if (g_readThread.joinable()) {
+		g_readThread.join();
+	}
+
 	for (auto& controller : g_controllers) {
 		// release controller here
-		controller.valid = false;
+		controller.connection.store(duaLibUtils::connectionState::Closed, std::memory_order_seq_cst);
+		controller.waitIoIdle();
 		controller.sceHandle = 0;
 		controller.lastPath = "";
 		controller.productID = 0;
-		controller.wasDisconnected = true;
 		controller.macAddress = "";
 
 		duaLibUtils::letGo(controller.handle, controller.deviceType, controller.connectionType);
+		duaLibUtils::closeInputFd(controller);
 	}
 	g_particularMode = false;
 
-	//if (g_readThread.joinable()) {
-	//	g_readThread.join();
-	//}
-	//if (g_watchThread.joinable()) {
-	//	g_watchThread.join();
-	//}
+#if defined(__linux__)
+	if (g_wakeFd >= 0) {
+		close(g_wakeFd);
+		g_wakeFd = -1;
+	}
+#endif
+	duaLibUtils::closeHotplugMonitor(g_hotplug);
 	return SCE_OK;
 }
 
@@ -357,15 +940,37 @@ int scePadOpen(int userID, int unk1, int unk2) {
 	}
 
 	if (!wasAlreadyOpened) {
+		if (firstUnused == -1) return SCE_PAD_ERROR_NO_HANDLE; // every slot is taken
+
 		int handle = sizeof(duaLibUtils::controller) * (firstUnused + 1);
 		g_controllers[firstUnused].sceHandle = handle;
 		g_controllers[firstUnused].opened = true;
 		g_controllers[firstUnused].playerIndex = userID;
+		{
+			std::lock_guard guard(g_controllers[firstUnused].rotationLock);
+			g_controllers[firstUnused].rotationBaseline = false;
+		}
+		{
+			std::lock_guard guard(g_controllers[firstUnused].gestureLock); // a new owner starts with the recognizer off
+			g_controllers[firstUnused].gestureConfig = {};
+			g_controllers[firstUnused].gestureConfigChanged.store(true, std::memory_order_release);
+			s_ScePadGestureEvent stale = {};
+			while (g_controllers[firstUnused].gestureEvents.pop(stale)) {}
+		}
+		{
+			std::lock_guard guard(g_controllers[firstUnused].connectionEventLock); // older transitions belonged to the previous owner
+			s_ScePadConnectionEvent stale = {};
+			while (g_controllers[firstUnused].connectionEvents.pop(stale)) {}
+		}
 
-		g_controllers[firstUnused].dualshock4CurOutputState.LedRed = g_playerColors[userID - 1].r;
-		g_controllers[firstUnused].dualshock4CurOutputState.LedGreen = g_playerColors[userID - 1].g;
-		g_controllers[firstUnused].dualshock4CurOutputState.LedBlue = g_playerColors[userID - 1].b;
+		duaLibUtils::outputCommand command = {};
+		command.type = duaLibUtils::outputCommandType::PlayerColor;
+		command.values[0] = g_playerColors[userID - 1].r;
+		command.values[1] = g_playerColors[userID - 1].g;
+		command.values[2] = g_playerColors[userID - 1].b;
+		g_controllers[firstUnused].commands.push(command);
 
+		wakeReader();
 		return handle;
 	}
 
@@ -383,289 +988,244 @@ int scePadGetParticularMode() {
 	return g_particularMode;
 }
 
-static float Vec3Length(const s_SceFVector3& v) {
-	return std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+// Translates the newest report into s_ScePadData, instantiated once per device type. I/O thread only.
+template <typename Traits>
+static void translateState(duaLibUtils::controller& controller, s_ScePadData* data) {
+	const auto& input = Traits::input(controller);
+
+	data->bitmask_buttons = duaLibUtils::buttonMask<Traits>(input);
+
+	data->LeftStick.X = input.LeftStickX;
+	data->LeftStick.Y = input.LeftStickY;
+	data->RightStick.X = input.RightStickX;
+	data->RightStick.Y = input.RightStickY;
+
+	data->L2_Analog = input.TriggerLeft;
+	data->R2_Analog = input.TriggerRight;
+
+	// Integrated per report by updateMotion, this only picks up the newest values
+	if (controller.motionSensorState.load(std::memory_order_relaxed)) {
+		data->acceleration = controller.acceleration;
+		data->angularVelocity = controller.angularVelocity;
+
+		data->orientation.x = controller.orientation.x;
+		data->orientation.y = controller.orientation.z;
+		data->orientation.z = controller.orientation.y; // yes this is swapped on purpose don't touch it
+		data->orientation.w = controller.orientation.w;
+	}
+
+	Traits::touch(input, data->touchData);
+
+	data->connected = true;
+	data->timestamp = Traits::timestamp(input);
+	data->extUnitData = {};
+	data->connectionCount = 0;
+	for (int j = 0; j < 12; j++)
+		data->deviceUniqueData[j] = {};
+	data->deviceUniqueDataLen = sizeof(data->deviceUniqueData);
 }
 
-static s_SceFVector3 Vec3Normalize(const s_SceFVector3& v) {
-	float len = Vec3Length(v);
-	if (len > 0.0f) {
-		return { v.x / len, v.y / len, v.z / len };
+static void translateState(duaLibUtils::controller& controller, s_ScePadData* data) {
+	if (controller.deviceType == DUALSENSE) {
+		translateState<duaLibUtils::dualsenseTraits>(controller, data);
+	}
+	else if (controller.deviceType == DUALSHOCK4) {
+		translateState<duaLibUtils::dualshock4Traits>(controller, data);
 	}
-	return v;
 }
 
-constexpr float angVelScale = 50.0f / 32767.0f;
-constexpr float angVelScaleDS4 = 40.0f / 32767.0f;
-// To m/s^2: 0.98 mg/LSB (BMI055 data sheet Chapter 5.2.1)
-static double to_mpss(int v) {
-	return static_cast<double>(v) / (pow(2, 13) - 1) * 9.80665 * 0.098;
+// What a pad reads before its first report: sticks centred, identity orientation
+static void neutralState(duaLibUtils::publishedState& state) {
+	state = {};
+	state.data.LeftStick = { 128, 128 };
+	state.data.RightStick = { 128, 128 };
+	state.data.orientation = { 0.0f, 0.0f, 0.0f, 1.0f };
+	state.data.connected = true;
+	state.data.deviceUniqueDataLen = sizeof(state.data.deviceUniqueData);
 }
 
-// To rad/s: 32767: 2000 deg/s (BMI055 data sheet Chapter 7.2.1)
-static double to_radps(int v) {
-	return static_cast<double>(v) / (pow(2, 15) - 1) * M_PI / 180.0 * 2000;
+static void publishState(duaLibUtils::controller& controller) {
+	duaLibUtils::publishedState state = {};
+	bool published = controller.state.load(state); // motion fields keep their last values while the sensors are off
+	if (!published) neutralState(state);
+	s_ScePadData last = state.data;
+	int64_t lastUs = state.sampleUs;
+
+	translateState(controller, &state.data);
+	state.sampleUs = controller.timing.lastArrivalUs;
+	state.angularAcceleration = controller.angularAcceleration;
+	std::copy(std::begin(controller.rotation), std::end(controller.rotation), std::begin(state.rotation));
+	if (controller.motionSensorState.load(std::memory_order_relaxed)) {
+		const auto& g = controller.gravity;
+		const auto& a = controller.acceleration;
+		state.motion.gravity = g;
+		state.motion.linearAcceleration = { a.x - g.x, a.y - g.y, a.z - g.z };
+	}
+
+	int64_t elapsedUs = state.sampleUs - lastUs;
+	if (published && elapsedUs > 0 && elapsedUs <= MAX_MOTION_GAP_US) {
+		duaLibUtils::trackStickVelocity(state, last, elapsedUs);
+	}
+	else {
+		std::fill(std::begin(state.stickVelocity), std::end(state.stickVelocity), 0.0f);
+	}
+
+	controller.state.store(state);
 }
 
-int scePadReadState(int handle, s_ScePadData* data) {
+// Wait-free copy of what the I/O thread published for the newest report, no lock and no translation here
+// published is false while the slot hasn't had a report since bring-up, state is neutral then
+static int loadState(int handle, duaLibUtils::publishedState& state, bool& motion, bool* published = nullptr) {
 	if (!g_initialized) return SCE_PAD_ERROR_NOT_INITIALIZED;
-	if (!data) return SCE_PAD_ERROR_INVALID_ARG;
 
-	for (auto& controller : g_controllers) {
-		std::shared_lock guard(controller.lock);
+	auto* slot = getController(handle);
+	if (!slot) return SCE_PAD_ERROR_INVALID_HANDLE;
 
-		if (controller.sceHandle != handle) continue;
+	auto& controller = *slot;
 
-		if (!controller.valid) return SCE_PAD_ERROR_DEVICE_NOT_CONNECTED;
+	if (!controller.isLive()) return SCE_PAD_ERROR_DEVICE_NOT_CONNECTED;
 
-		if (controller.deviceType == DUALSENSE) {
-		#pragma region buttons
-			uint32_t bitmaskButtons = 0;
-			if (controller.dualsenseCurInputState.ButtonCross) bitmaskButtons |= SCE_BM_CROSS;
-			if (controller.dualsenseCurInputState.ButtonCircle) bitmaskButtons |= SCE_BM_CIRCLE;
-			if (controller.dualsenseCurInputState.ButtonTriangle) bitmaskButtons |= SCE_BM_TRIANGLE;
-			if (controller.dualsenseCurInputState.ButtonSquare) bitmaskButtons |= SCE_BM_SQUARE;
+	bool loaded = controller.state.load(state);
+	if (!loaded) {
+		neutralState(state);
+	}
+	if (published) *published = loaded;
 
-			if (controller.dualsenseCurInputState.ButtonL1) bitmaskButtons |= SCE_BM_L1;
-			if (controller.dualsenseCurInputState.ButtonL2) bitmaskButtons |= SCE_BM_L2;
-			if (controller.dualsenseCurInputState.ButtonR1) bitmaskButtons |= SCE_BM_R1;
-			if (controller.dualsenseCurInputState.ButtonR2) bitmaskButtons |= SCE_BM_R2;
+	if (!g_particularMode) {
+		state.data.bitmask_buttons &= ~(SCE_BM_SHARE | SCE_BM_PSBTN);
+	}
 
-			if (controller.dualsenseCurInputState.ButtonL3) bitmaskButtons |= SCE_BM_L3;
-			if (controller.dualsenseCurInputState.ButtonR3) bitmaskButtons |= SCE_BM_R3;
+	motion = controller.motionSensorState.load(std::memory_order_relaxed);
+	return SCE_OK;
+}
 
-			if (controller.dualsenseCurInputState.DPad == Direction::NorthEast) bitmaskButtons |= SCE_BM_N_DPAD + SCE_BM_E_DPAD;
-			if (controller.dualsenseCurInputState.DPad == Direction::NorthWest) bitmaskButtons |= SCE_BM_N_DPAD + SCE_BM_W_DPAD;
-			if (controller.dualsenseCurInputState.DPad == Direction::SouthEast) bitmaskButtons |= SCE_BM_S_DPAD + SCE_BM_E_DPAD;
-			if (controller.dualsenseCurInputState.DPad == Direction::SouthWest) bitmaskButtons |= SCE_BM_S_DPAD + SCE_BM_W_DPAD;
+int scePadReadState(int handle, s_ScePadData* data) {
+	if (!data) return g_initialized ? SCE_PAD_ERROR_INVALID_ARG : SCE_PAD_ERROR_NOT_INITIALIZED;
 
-			if (controller.dualsenseCurInputState.DPad == Direction::North) bitmaskButtons |= SCE_BM_N_DPAD;
-			if (controller.dualsenseCurInputState.DPad == Direction::South) bitmaskButtons |= SCE_BM_S_DPAD;
-			if (controller.dualsenseCurInputState.DPad == Direction::East) bitmaskButtons |= SCE_BM_E_DPAD;
-			if (controller.dualsenseCurInputState.DPad == Direction::West) bitmaskButtons |= SCE_BM_W_DPAD;
+	duaLibUtils::publishedState state = {};
+	bool motion = false;
+	int res = loadState(handle, state, motion);
+	if (res != SCE_OK) return res;
 
-			if (controller.dualsenseCurInputState.ButtonOptions) bitmaskButtons |= SCE_BM_OPTIONS;
+	*data = state.data;
+	return SCE_OK;
+}
 
-			if (controller.dualsenseCurInputState.ButtonPad) bitmaskButtons |= SCE_BM_TOUCH;
+int scePadReadStateAt(int handle, s_ScePadData* data, int64_t targetTimeUs) {
+	if (!data) return g_initialized ? SCE_PAD_ERROR_INVALID_ARG : SCE_PAD_ERROR_NOT_INITIALIZED;
 
-			if (g_particularMode) {
-				if (controller.dualsenseCurInputState.ButtonCreate) bitmaskButtons |= SCE_BM_SHARE;
-				if (controller.dualsenseCurInputState.ButtonHome) bitmaskButtons |= SCE_BM_PSBTN;
-			}
+	duaLibUtils::publishedState state = {};
+	bool motion = false;
+	int res = loadState(handle, state, motion);
+	if (res != SCE_OK) return res;
 
-			data->bitmask_buttons = bitmaskButtons;
-		#pragma endregion
-
-		#pragma region sticks
-			data->LeftStick.X = controller.dualsenseCurInputState.LeftStickX;
-			data->LeftStick.Y = controller.dualsenseCurInputState.LeftStickY;
-			data->RightStick.X = controller.dualsenseCurInputState.RightStickX;
-			data->RightStick.Y = controller.dualsenseCurInputState.RightStickY;
-		#pragma endregion
-
-		#pragma region triggers
-			data->L2_Analog = controller.dualsenseCurInputState.TriggerLeft;
-			data->R2_Analog = controller.dualsenseCurInputState.TriggerRight;
-		#pragma endregion
-
-		#pragma region gyro		
-			if (controller.motionSensorState) {
-				auto now = std::chrono::steady_clock::now();
-				controller.deltaTime = std::chrono::duration_cast<std::chrono::microseconds>(now - controller.lastUpdate).count() / 1000000.0f;
-				controller.lastUpdate = now;
-
-				data->acceleration.x = to_mpss((float)controller.dualsenseCurInputState.AccelerometerX);
-				data->acceleration.y = to_mpss((float)controller.dualsenseCurInputState.AccelerometerY);
-				data->acceleration.z = to_mpss((float)controller.dualsenseCurInputState.AccelerometerZ);
-
-				data->angularVelocity.x = to_radps((float)controller.dualsenseCurInputState.AngularVelocityX);
-				data->angularVelocity.y = to_radps((float)controller.dualsenseCurInputState.AngularVelocityY);
-				data->angularVelocity.z = to_radps((float)controller.dualsenseCurInputState.AngularVelocityZ);
-
-				data->angularVelocity.x = controller.velocityDeadband == true && (data->angularVelocity.x < ANGULAR_VELOCITY_DEADBAND_MIN && data->angularVelocity.x > -ANGULAR_VELOCITY_DEADBAND_MIN) ? 0 : data->angularVelocity.x;
-				data->angularVelocity.y = controller.velocityDeadband == true && (data->angularVelocity.y < ANGULAR_VELOCITY_DEADBAND_MIN && data->angularVelocity.y > -ANGULAR_VELOCITY_DEADBAND_MIN) ? 0 : data->angularVelocity.y;
-				data->angularVelocity.z = controller.velocityDeadband == true && (data->angularVelocity.z < ANGULAR_VELOCITY_DEADBAND_MIN && data->angularVelocity.z > -ANGULAR_VELOCITY_DEADBAND_MIN) ? 0 : data->angularVelocity.z;
-
-				auto& q = controller.orientation;
-				s_SceFQuaternion w = {
-					data->angularVelocity.x,
-					data->angularVelocity.y,
-					data->angularVelocity.z,
-					0.0f
-				};
-
-				s_SceFQuaternion qw = {
-				  q.w * w.x + q.x * w.w + q.y * w.z - q.z * w.y,
-				  q.w * w.y + q.y * w.w + q.z * w.x - q.x * w.z,
-				  q.w * w.z + q.z * w.w + q.x * w.y - q.y * w.x,
-				  q.w * w.w - q.x * w.x - q.y * w.y - q.z * w.z
-				};
-
-				s_SceFQuaternion qDot = { 0.5f * qw.x, 0.5f * qw.y, 0.5f * qw.z, 0.5f * qw.w };
-
-				q.x += qDot.x * controller.deltaTime;
-				q.y += qDot.y * controller.deltaTime;
-				q.z += qDot.z * controller.deltaTime;
-				q.w += qDot.w * controller.deltaTime;
-
-				float norm = std::sqrt(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
-				q.x /= norm; q.y /= norm; q.z /= norm; q.w /= norm;
-
-				data->orientation.x = q.x;
-				data->orientation.y = q.z;
-				data->orientation.z = q.y; // yes this is swapped on purpose don't touch it
-				data->orientation.w = q.w;
-			}
-		#pragma endregion
-
-		#pragma region touchpad
-			data->touchData.touchNum = (controller.dualsenseCurInputState.touchData.Finger[0].NotTouching > 0 ? 0 : 1) + (controller.dualsenseCurInputState.touchData.Finger[1].NotTouching > 0 ? 0 : 1);
-
-			data->touchData.touch[0].id = controller.dualsenseCurInputState.touchData.Finger[0].Index;
-			data->touchData.touch[0].x = controller.dualsenseCurInputState.touchData.Finger[0].FingerX;
-			data->touchData.touch[0].y = controller.dualsenseCurInputState.touchData.Finger[0].FingerY;
-
-			data->touchData.touch[1].id = controller.dualsenseCurInputState.touchData.Finger[1].Index;
-			data->touchData.touch[1].x = controller.dualsenseCurInputState.touchData.Finger[1].FingerX;
-			data->touchData.touch[1].y = controller.dualsenseCurInputState.touchData.Finger[1].FingerY;
-		#pragma endregion
-
-		#pragma region misc
-			data->connected = controller.valid;
-			data->timestamp = controller.dualsenseCurInputState.DeviceTimeStamp;
-			data->extUnitData = {};
-			data->connectionCount = 0;
-			for (int j = 0; j < 12; j++)
-				data->deviceUniqueData[j] = {};
-			data->deviceUniqueDataLen = sizeof(data->deviceUniqueData);
-		#pragma endregion
+	if (state.sampleUs != 0) {
+		int64_t leadUs = std::clamp<int64_t>(targetTimeUs - state.sampleUs, 0, MAX_PREDICTION_US);
+		if (leadUs > 0) {
+			duaLibUtils::predictState(state, leadUs / 1000000.0f, motion);
 		}
-		else if (controller.deviceType == DUALSHOCK4) {
-		#pragma region buttons
-			uint32_t bitmaskButtons = 0;
-			if (controller.dualshock4CurInputState.ButtonCross) bitmaskButtons |= SCE_BM_CROSS;
-			if (controller.dualshock4CurInputState.ButtonCircle) bitmaskButtons |= SCE_BM_CIRCLE;
-			if (controller.dualshock4CurInputState.ButtonTriangle) bitmaskButtons |= SCE_BM_TRIANGLE;
-			if (controller.dualshock4CurInputState.ButtonSquare) bitmaskButtons |= SCE_BM_SQUARE;
-
-			if (controller.dualshock4CurInputState.ButtonL1) bitmaskButtons |= SCE_BM_L1;
-			if (controller.dualshock4CurInputState.ButtonL2) bitmaskButtons |= SCE_BM_L2;
-			if (controller.dualshock4CurInputState.ButtonR1) bitmaskButtons |= SCE_BM_R1;
-			if (controller.dualshock4CurInputState.ButtonR2) bitmaskButtons |= SCE_BM_R2;
-
-			if (controller.dualshock4CurInputState.ButtonL3) bitmaskButtons |= SCE_BM_L3;
-			if (controller.dualshock4CurInputState.ButtonR3) bitmaskButtons |= SCE_BM_R3;
-
-			if (controller.dualshock4CurInputState.DPad == Direction::NorthEast) bitmaskButtons |= SCE_BM_N_DPAD + SCE_BM_E_DPAD;
-			if (controller.dualshock4CurInputState.DPad == Direction::NorthWest) bitmaskButtons |= SCE_BM_N_DPAD + SCE_BM_W_DPAD;
-			if (controller.dualshock4CurInputState.DPad == Direction::SouthEast) bitmaskButtons |= SCE_BM_S_DPAD + SCE_BM_E_DPAD;
-			if (controller.dualshock4CurInputState.DPad == Direction::SouthWest) bitmaskButtons |= SCE_BM_S_DPAD + SCE_BM_W_DPAD;
-
-			if (controller.dualshock4CurInputState.DPad == Direction::North) bitmaskButtons |= SCE_BM_N_DPAD;
-			if (controller.dualshock4CurInputState.DPad == Direction::South) bitmaskButtons |= SCE_BM_S_DPAD;
-			if (controller.dualshock4CurInputState.DPad == Direction::East) bitmaskButtons |= SCE_BM_E_DPAD;
-			if (controller.dualshock4CurInputState.DPad == Direction::West) bitmaskButtons |= SCE_BM_W_DPAD;
-
-			if (controller.dualshock4CurInputState.ButtonOptions) bitmaskButtons |= SCE_BM_OPTIONS;
-
-			if (controller.dualshock4CurInputState.ButtonPad) bitmaskButtons |= SCE_BM_TOUCH;
-
-			if (g_particularMode) {
-				if (controller.dualshock4CurInputState.ButtonShare) bitmaskButtons |= SCE_BM_SHARE;
-				if (controller.dualshock4CurInputState.ButtonHome) bitmaskButtons |= SCE_BM_PSBTN;
-			}
+	}
 
-			data->bitmask_buttons = bitmaskButtons;
-		#pragma endregion
-
-		#pragma region sticks
-			data->LeftStick.X = controller.dualshock4CurInputState.LeftStickX;
-			data->LeftStick.Y = controller.dualshock4CurInputState.LeftStickY;
-			data->RightStick.X = controller.dualshock4CurInputState.RightStickX;
-			data->RightStick.Y = controller.dualshock4CurInputState.RightStickY;
-		#pragma endregion
-
-		#pragma region triggers
-			data->L2_Analog = controller.dualshock4CurInputState.TriggerLeft;
-			data->R2_Analog = controller.dualshock4CurInputState.TriggerRight;
-		#pragma endregion
-
-		#pragma region gyro		
-			if (controller.motionSensorState) {
-				auto now = std::chrono::steady_clock::now();
-				controller.deltaTime = std::chrono::duration_cast<std::chrono::microseconds>(now - controller.lastUpdate).count() / 1000000.0f;
-				controller.lastUpdate = now;
-
-				data->acceleration.x = to_mpss((float)controller.dualshock4CurInputState.AccelerometerX);
-				data->acceleration.y = to_mpss((float)controller.dualshock4CurInputState.AccelerometerY);
-				data->acceleration.z = to_mpss((float)controller.dualshock4CurInputState.AccelerometerZ);
-
-				data->angularVelocity.x = to_radps((float)controller.dualshock4CurInputState.AngularVelocityX);
-				data->angularVelocity.y = to_radps((float)controller.dualshock4CurInputState.AngularVelocityY);
-				data->angularVelocity.z = to_radps((float)controller.dualshock4CurInputState.AngularVelocityZ);
-
-				data->angularVelocity.x = controller.velocityDeadband == true && (data->angularVelocity.x < ANGULAR_VELOCITY_DEADBAND_MIN && data->angularVelocity.x > -ANGULAR_VELOCITY_DEADBAND_MIN) ? 0 : data->angularVelocity.x;
-				data->angularVelocity.y = controller.velocityDeadband == true && (data->angularVelocity.y < ANGULAR_VELOCITY_DEADBAND_MIN && data->angularVelocity.y > -ANGULAR_VELOCITY_DEADBAND_MIN) ? 0 : data->angularVelocity.y;
-				data->angularVelocity.z = controller.velocityDeadband == true && (data->angularVelocity.z < ANGULAR_VELOCITY_DEADBAND_MIN && data->angularVelocity.z > -ANGULAR_VELOCITY_DEADBAND_MIN) ? 0 : data->angularVelocity.z;
-
-				auto& q = controller.orientation;
-				s_SceFQuaternion w = { data->angularVelocity.x,
-						   data->angularVelocity.y,
-						   data->angularVelocity.z,
-						   0.0f };
-
-				s_SceFQuaternion qw = {
-				  q.w * w.x + q.x * w.w + q.y * w.z - q.z * w.y,
-				  q.w * w.y + q.y * w.w + q.z * w.x - q.x * w.z,
-				  q.w * w.z + q.z * w.w + q.x * w.y - q.y * w.x,
-				  q.w * w.w - q.x * w.x - q.y * w.y - q.z * w.z
-				};
-
-				s_SceFQuaternion qDot = { 0.5f * qw.x, 0.5f * qw.y, 0.5f * qw.z, 0.5f * qw.w };
-
-				q.x += qDot.x * controller.deltaTime;
-				q.y += qDot.y * controller.deltaTime;
-				q.z += qDot.z * controller.deltaTime;
-				q.w += qDot.w * controller.deltaTime;
-
-				float norm = std::sqrt(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
-				q.x /= norm; q.y /= norm; q.z /= norm; q.w /= norm;
-
-				data->orientation.x = q.x;
-				data->orientation.y = q.z;
-				data->orientation.z = q.y;  // yes this is swapped on purpose don't touch it
-				data->orientation.w = q.w;
-			}
-		#pragma endregion
-
-		#pragma region touchpad
-			data->touchData.touchNum = (controller.dualshock4CurInputState.Finger1Active > 0 ? 0 : 1) + (controller.dualshock4CurInputState.Finger2Active > 0 ? 0 : 1);
-
-			data->touchData.touch[0].id = controller.dualshock4CurInputState.Finger1ID;
-			data->touchData.touch[0].x = controller.dualshock4CurInputState.Finger1X;
-			data->touchData.touch[0].y = controller.dualshock4CurInputState.Finger1Y;
-
-			data->touchData.touch[1].id = controller.dualshock4CurInputState.Finger2ID;
-			data->touchData.touch[1].x = controller.dualshock4CurInputState.Finger2X;
-			data->touchData.touch[1].y = controller.dualshock4CurInputState.Finger2Y;
-		#pragma endregion
-
-		#pragma region misc
-			data->connected = controller.valid;
-			data->timestamp = controller.dualshock4CurInputState.Timestamp;
-			data->extUnitData = {};
-			data->connectionCount = 0;
-			for (int j = 0; j < 12; j++)
-				data->deviceUniqueData[j] = {};
-			data->deviceUniqueDataLen = sizeof(data->deviceUniqueData);
-		#pragma endregion
+	*data = state.data;
+	return SCE_OK;
+}
 
-		}
+int scePadGetAccumulatedRotation(int handle, s_SceFVector3* rotation) {
+	if (!rotation) return g_initialized ? SCE_PAD_ERROR_INVALID_ARG : SCE_PAD_ERROR_NOT_INITIALIZED;
 
+	duaLibUtils::publishedState state = {};
+	bool motion = false;
+	bool published = false;
+	int res = loadState(handle, state, motion, &published);
+	if (res != SCE_OK) return res;
+
+	// Right after a (re)connect the snapshot is empty, not a total of zero. Nothing turned that we could report.
+	if (!published) {
+		*rotation = { 0.0f, 0.0f, 0.0f };
 		return SCE_OK;
 	}
 
-	return SCE_PAD_ERROR_INVALID_HANDLE;
+	// The I/O thread only ever adds to the published total, the delta since the last call covers every report
+	auto& controller = *getController(handle);
+	std::lock_guard guard(controller.rotationLock);
+
+	if (!controller.rotationBaseline) {
+		std::copy(std::begin(state.rotation), std::end(state.rotation), std::begin(controller.rotationRead));
+		controller.rotationBaseline = true;
+	}
+
+	rotation->x = static_cast<float>(state.rotation[0] - controller.rotationRead[0]);
+	rotation->y = static_cast<float>(state.rotation[1] - controller.rotationRead[1]);
+	rotation->z = static_cast<float>(state.rotation[2] - controller.rotationRead[2]);
+	std::copy(std::begin(state.rotation), std::end(state.rotation), std::begin(controller.rotationRead));
+
+	return SCE_OK;
+}
+
+int scePadGetMotionData(int handle, s_ScePadMotionData* motionData) {
+	if (!motionData) return g_initialized ? SCE_PAD_ERROR_INVALID_ARG : SCE_PAD_ERROR_NOT_INITIALIZED;
+
+	duaLibUtils::publishedState state = {};
+	bool motion = false;
+	int res = loadState(handle, state, motion);
+	if (res != SCE_OK) return res;
+
+	*motionData = state.motion;
+	return SCE_OK;
+}
+
+int scePadSetGestureConfig(int handle, const s_ScePadGestureConfig* config) {
+	if (!g_initialized) return SCE_PAD_ERROR_NOT_INITIALIZED;
+	if (!config) return SCE_PAD_ERROR_INVALID_ARG;
+
+	auto* slot = getController(handle);
+	if (!slot) return SCE_PAD_ERROR_INVALID_HANDLE;
+
+	auto& controller = *slot;
+	if (!controller.isLive()) return SCE_PAD_ERROR_DEVICE_NOT_CONNECTED;
+
+	std::lock_guard guard(controller.gestureLock);
+	controller.gestureConfig = *config;
+	controller.gestureConfigChanged.store(true, std::memory_order_release);
+
+	return SCE_OK;
+}
+
+int scePadGetGestureEvents(int handle, s_ScePadGestureEvent* events, int maxCount) {
+	if (!g_initialized) return SCE_PAD_ERROR_NOT_INITIALIZED;
+	if (!events || maxCount < 0) return SCE_PAD_ERROR_INVALID_ARG;
+
+	auto* slot = getController(handle);
+	if (!slot) return SCE_PAD_ERROR_INVALID_HANDLE;
+
+	auto& controller = *slot;
+	if (!controller.isLive()) return SCE_PAD_ERROR_DEVICE_NOT_CONNECTED;
+
+	std::lock_guard guard(controller.gestureLock); // the ring has a single consumer
+	int count = 0;
+	while (count < maxCount && controller.gestureEvents.pop(events[count])) {
+		count++;
+	}
+
+	return count;
+}
+
+// Unlike the other getters this works on a lost slot, that's when the game wants to hear about it
+int scePadGetConnectionEvents(int handle, s_ScePadConnectionEvent* events, int maxCount) {
+	if (!g_initialized) return SCE_PAD_ERROR_NOT_INITIALIZED;
+	if (!events || maxCount < 0) return SCE_PAD_ERROR_INVALID_ARG;
+
+	auto* slot = getController(handle);
+	if (!slot) return SCE_PAD_ERROR_INVALID_HANDLE;
+
+	auto& controller = *slot;
+	std::lock_guard guard(controller.connectionEventLock);
+	int count = 0;
+	while (count < maxCount && controller.connectionEvents.pop(events[count])) {
+		count++;
+	}
+
+	return count;
 }
 
 int scePadGetContainerIdInformation(int handle, s_ScePadContainerIdInfo* containerIdInfo) {
@@ -673,10 +1233,12 @@ int scePadGetContainerIdInformation(int handle, s_ScePadContainerIdInfo* contain
 	if (!containerIdInfo) return SCE_PAD_ERROR_INVALID_ARG;
 
 #if defined(_WIN32) || defined(_WIN64) // Windows only for now
-	for (auto& controller : g_controllers) {
+	if (auto* slot = getController(handle)) {
+		auto& controller = *slot;
 		std::shared_lock guard(controller.lock);
-		if (controller.sceHandle == handle && controller.id != "" && controller.idSize != 0) {
-			if (!controller.valid) return SCE_PAD_ERROR_DEVICE_NOT_CONNECTED;
+
+		if (controller.id != "" && controller.idSize != 0) {
+			if (!controller.isLive()) return SCE_PAD_ERROR_DEVICE_NOT_CONNECTED;
 
 			s_ScePadContainerIdInfo info = {};
 			info.size = controller.idSize;
@@ -690,6 +1252,7 @@ int scePadGetContainerIdInformation(int handle, s_ScePadContainerIdInfo* contain
 	containerIdInfo->id[0] = '\0';
 	return SCE_OK;
 #else
+	(void)handle;
 	return SCE_PAD_ERROR_NOT_PERMITTED;
 #endif
 }
@@ -697,27 +1260,20 @@ int scePadGetContainerIdInformation(int handle, s_ScePadContainerIdInfo* contain
 int scePadSetLightBar(int handle, s_SceLightBar* lightbar) {
 	if (!g_initialized) return SCE_PAD_ERROR_NOT_INITIALIZED;
 
-	for (auto& controller : g_controllers) {
-		std::shared_lock guard(controller.lock);
+	auto* slot = getController(handle);
+	if (!slot) return SCE_PAD_ERROR_INVALID_HANDLE;
 
-		if (controller.sceHandle != handle) continue;
-		if (!controller.valid) return SCE_PAD_ERROR_DEVICE_NOT_CONNECTED;
+	auto& controller = *slot;
 
-		if (controller.deviceType == DUALSENSE) {
-			controller.dualsenseCurOutputState.LedRed = lightbar->r;
-			controller.dualsenseCurOutputState.LedGreen = lightbar->g;
-			controller.dualsenseCurOutputState.LedBlue = lightbar->b;
-		}
-		else if (controller.deviceType == DUALSHOCK4) {
-			controller.dualshock4CurOutputState.LedRed = lightbar->r;
-			controller.dualshock4CurOutputState.LedGreen = lightbar->g;
-			controller.dualshock4CurOutputState.LedBlue = lightbar->b;
-		}
+	if (!controller.isLive()) return SCE_PAD_ERROR_DEVICE_NOT_CONNECTED;
 
-		return SCE_OK;
-	}
+	duaLibUtils::outputCommand command = {};
+	command.type = duaLibUtils::outputCommandType::LightBar;
+	command.values[0] = lightbar->r;
+	command.values[1] = lightbar->g;
+	command.values[2] = lightbar->b;
 
-	return SCE_PAD_ERROR_INVALID_HANDLE;
+	return controller.commands.push(command) ? SCE_OK : SCE_PAD_ERROR_SEND_AGAIN;
 }
 
 int scePadGetHandle(int userID, int unk1, int unk2) {
@@ -742,270 +1298,264 @@ int scePadGetHandle(int userID, int unk1, int unk2) {
 int scePadResetLightBar(int handle) {
 	if (!g_initialized) return SCE_PAD_ERROR_NOT_INITIALIZED;
 
-	for (auto& controller : g_controllers) {
-		std::shared_lock guard(controller.lock);
+	auto* slot = getController(handle);
+	if (!slot) return SCE_PAD_ERROR_INVALID_HANDLE;
 
-		if (controller.sceHandle != handle) continue;
-		if (!controller.valid) return SCE_PAD_ERROR_DEVICE_NOT_CONNECTED;
+	auto& controller = *slot;
 
-		if (controller.deviceType == DUALSENSE) {
-			controller.dualsenseCurOutputState.LedRed = 0;
-			controller.dualsenseCurOutputState.LedGreen = 0;
-			controller.dualsenseCurOutputState.LedBlue = 0;
-		}
-		else if (controller.deviceType == DUALSHOCK4) {
-			controller.dualshock4CurOutputState.LedRed = 0;
-			controller.dualshock4CurOutputState.LedGreen = 0;
-			controller.dualshock4CurOutputState.LedBlue = 0;
-		}
-		return SCE_OK;
-	}
-	return SCE_PAD_ERROR_INVALID_HANDLE;
+	if (!controller.isLive()) return SCE_PAD_ERROR_DEVICE_NOT_CONNECTED;
+
+	duaLibUtils::outputCommand command = {};
+	command.type = duaLibUtils::outputCommandType::LightBar;
+
+	return controller.commands.push(command) ? SCE_OK : SCE_PAD_ERROR_SEND_AGAIN;
 }
 
 int scePadSetTriggerEffect(int handle, ScePadTriggerEffectParam* triggerEffect) {
 	if (!g_initialized) return SCE_PAD_ERROR_NOT_INITIALIZED;
 
-	for (auto& controller : g_controllers) {
-		std::shared_lock guard(controller.lock);
+	auto* slot = getController(handle);
+	if (!slot) return SCE_PAD_ERROR_INVALID_HANDLE;
 
-		if (controller.sceHandle != handle) continue;
-		if (!controller.valid) return SCE_PAD_ERROR_DEVICE_NOT_CONNECTED;
-		if (controller.deviceType != DUALSENSE) return SCE_PAD_ERROR_NOT_PERMITTED;
+	auto& controller = *slot;
 
-		controller.triggerMask = triggerEffect->triggerMask;
+	if (!controller.isLive()) return SCE_PAD_ERROR_DEVICE_NOT_CONNECTED;
+	if (controller.deviceType != DUALSENSE) return SCE_PAD_ERROR_NOT_PERMITTED;
 
-		for (int i = 0; i <= 1; i++) {
-			duaLibUtils::trigger _trigger = {};
+	// The effects are generated here, the I/O thread only copies the force blocks
+	duaLibUtils::outputCommand command = {};
+	command.type = duaLibUtils::outputCommandType::TriggerEffect;
+	command.triggerMask = triggerEffect->triggerMask;
 
-			if (triggerEffect->command[i].mode == ScePadTriggerEffectMode::SCE_PAD_TRIGGER_EFFECT_MODE_OFF) {
-				TriggerEffectGenerator::Off(_trigger.force, 0);
-			}
-			else if (triggerEffect->command[i].mode == ScePadTriggerEffectMode::SCE_PAD_TRIGGER_EFFECT_MODE_FEEDBACK) {
-				TriggerEffectGenerator::Feedback(_trigger.force, 0, triggerEffect->command[i].commandData.feedbackParam.position, triggerEffect->command[i].commandData.feedbackParam.strength);
-			}
-			else if (triggerEffect->command[i].mode == ScePadTriggerEffectMode::SCE_PAD_TRIGGER_EFFECT_MODE_WEAPON) {
-				TriggerEffectGenerator::Weapon(_trigger.force, 0, triggerEffect->command[i].commandData.weaponParam.startPosition, triggerEffect->command[i].commandData.weaponParam.endPosition, triggerEffect->command[i].commandData.weaponParam.strength);
-			}
-			else if (triggerEffect->command[i].mode == ScePadTriggerEffectMode::SCE_PAD_TRIGGER_EFFECT_MODE_VIBRATION) {
-				TriggerEffectGenerator::Vibration(_trigger.force, 0, triggerEffect->command[i].commandData.vibrationParam.position, triggerEffect->command[i].commandData.vibrationParam.amplitude, triggerEffect->command[i].commandData.vibrationParam.frequency);
-			}
-			else if (triggerEffect->command[i].mode == ScePadTriggerEffectMode::SCE_PAD_TRIGGER_EFFECT_MODE_SLOPE_FEEDBACK) {
-				TriggerEffectGenerator::SlopeFeedback(_trigger.force, 0, triggerEffect->command[i].commandData.slopeFeedbackParam.startPosition, triggerEffect->command[i].commandData.slopeFeedbackParam.endPosition, triggerEffect->command[i].commandData.slopeFeedbackParam.startStrength, triggerEffect->command[i].commandData.slopeFeedbackParam.endStrength);
-			}
-			else if (triggerEffect->command[i].mode == ScePadTriggerEffectMode::SCE_PAD_TRIGGER_EFFECT_MODE_MULTIPLE_POSITION_FEEDBACK) {
-				TriggerEffectGenerator::MultiplePositionFeedback(_trigger.force, 0, triggerEffect->command[i].commandData.multiplePositionFeedbackParam.strength);
-			}
-			else if (triggerEffect->command[i].mode == ScePadTriggerEffectMode::SCE_PAD_TRIGGER_EFFECT_MODE_MULTIPLE_POSITION_VIBRATION) {
-				TriggerEffectGenerator::MultiplePositionVibration(_trigger.force, 0, triggerEffect->command[i].commandData.multiplePositionVibrationParam.frequency, triggerEffect->command[i].commandData.multiplePositionVibrationParam.amplitude);
-			}
+	for (int i = 0; i <= 1; i++) {
+		duaLibUtils::trigger _trigger = {};
 
-			if (i == SCE_PAD_TRIGGER_EFFECT_PARAM_INDEX_FOR_L2) {
-				for (int i = 0; i < 11; i++) {
-					controller.L2.force[i] = _trigger.force[i];
-				}
+		if (triggerEffect->command[i].mode == ScePadTriggerEffectMode::SCE_PAD_TRIGGER_EFFECT_MODE_OFF) {
+			TriggerEffectGenerator::Off(_trigger.force, 0);
+		}
+		else if (triggerEffect->command[i].mode == ScePadTriggerEffectMode::SCE_PAD_TRIGGER_EFFECT_MODE_FEEDBACK) {
+			TriggerEffectGenerator::Feedback(_trigger.force, 0, triggerEffect->command[i].commandData.feedbackParam.position, triggerEffect->command[i].commandData.feedbackParam.strength);
+		}
+		else if (triggerEffect->command[i].mode == ScePadTriggerEffectMode::SCE_PAD_TRIGGER_EFFECT_MODE_WEAPON) {
+			TriggerEffectGenerator::Weapon(_trigger.force, 0, triggerEffect->command[i].commandData.weaponParam.startPosition, triggerEffect->command[i].commandData.weaponParam.endPosition, triggerEffect->command[i].commandData.weaponParam.strength);
+		}
+		else if (triggerEffect->command[i].mode == ScePadTriggerEffectMode::SCE_PAD_TRIGGER_EFFECT_MODE_VIBRATION) {
+			TriggerEffectGenerator::Vibration(_trigger.force, 0, triggerEffect->command[i].commandData.vibrationParam.position, triggerEffect->command[i].commandData.vibrationParam.amplitude, triggerEffect->command[i].commandData.vibrationParam.frequency);
+		}
+		else if (triggerEffect->command[i].mode == ScePadTriggerEffectMode::SCE_PAD_TRIGGER_EFFECT_MODE_SLOPE_FEEDBACK) {
+			TriggerEffectGenerator::SlopeFeedback(_trigger.force, 0, triggerEffect->command[i].commandData.slopeFeedbackParam.startPosition, triggerEffect->command[i].commandData.slopeFeedbackParam.endPosition, triggerEffect->command[i].commandData.slopeFeedbackParam.startStrength, triggerEffect->command[i].commandData.slopeFeedbackParam.endStrength);
+		}
+		else if (triggerEffect->command[i].mode == ScePadTriggerEffectMode::SCE_PAD_TRIGGER_EFFECT_MODE_MULTIPLE_POSITION_FEEDBACK) {
+			TriggerEffectGenerator::MultiplePositionFeedback(_trigger.force, 0, triggerEffect->command[i].commandData.multiplePositionFeedbackParam.strength);
+		}
+		else if (triggerEffect->command[i].mode == ScePadTriggerEffectMode::SCE_PAD_TRIGGER_EFFECT_MODE_MULTIPLE_POSITION_VIBRATION) {
+			TriggerEffectGenerator::MultiplePositionVibration(_trigger.force, 0, triggerEffect->command[i].commandData.multiplePositionVibrationParam.frequency, triggerEffect->command[i].commandData.multiplePositionVibrationParam.amplitude);
+		}
+
+		if (i == SCE_PAD_TRIGGER_EFFECT_PARAM_INDEX_FOR_L2) {
+			for (int i = 0; i < 11; i++) {
+				command.L2.force[i] = _trigger.force[i];
 			}
-			else if (i == SCE_PAD_TRIGGER_EFFECT_PARAM_INDEX_FOR_R2) {
-				for (int i = 0; i < 11; i++) {
-					controller.R2.force[i] = _trigger.force[i];
-				}
+		}
+		else if (i == SCE_PAD_TRIGGER_EFFECT_PARAM_INDEX_FOR_R2) {
+			for (int i = 0; i < 11; i++) {
+				command.R2.force[i] = _trigger.force[i];
 			}
 		}
-
-		return SCE_OK;
 	}
-	return SCE_PAD_ERROR_INVALID_HANDLE;
+
+	return controller.commands.push(command) ? SCE_OK : SCE_PAD_ERROR_SEND_AGAIN;
 }
 
 int scePadGetControllerBusType(int handle, int* busType) {
 	if (!g_initialized) return SCE_PAD_ERROR_NOT_INITIALIZED;
 
-	for (auto& controller : g_controllers) {
-		std::shared_lock guard(controller.lock);
+	auto* slot = getController(handle);
+	if (!slot) return SCE_PAD_ERROR_INVALID_HANDLE;
 
-		if (controller.sceHandle != handle) continue;
-		if (!controller.valid) return SCE_PAD_ERROR_DEVICE_NOT_CONNECTED;
+	auto& controller = *slot;
+	std::shared_lock guard(controller.lock);
 
-		*busType = controller.connectionType;
+	if (!controller.isLive()) return SCE_PAD_ERROR_DEVICE_NOT_CONNECTED;
 
-		return SCE_OK;
-	}
-	return SCE_PAD_ERROR_INVALID_HANDLE;
+	*busType = controller.connectionType;
+
+	return SCE_OK;
 }
 
 int scePadGetControllerInformation(int handle, s_ScePadInfo* info) {
 	if (!g_initialized) return SCE_PAD_ERROR_NOT_INITIALIZED;
 
-	for (auto& controller : g_controllers) {
-		std::shared_lock guard(controller.lock);
+	auto* slot = getController(handle);
+	if (!slot) return SCE_PAD_ERROR_INVALID_HANDLE;
 
-		if (controller.sceHandle != handle) continue;
-		if (!controller.valid) return SCE_PAD_ERROR_DEVICE_NOT_CONNECTED;
+	auto& controller = *slot;
+	std::shared_lock guard(controller.lock);
 
-		s_ScePadInfo _info = {};
+	if (!controller.isLive()) return SCE_PAD_ERROR_DEVICE_NOT_CONNECTED;
 
-		_info.touchPadInfo.resolution.x = controller.deviceType == DUALSENSE ? 1920 : 1920;
-		_info.touchPadInfo.resolution.y = controller.deviceType == DUALSENSE ? 1080 : 943;
-		_info.touchPadInfo.pixelDensity = controller.deviceType == DUALSENSE ? 44.86 : 44;
-		_info.stickInfo.deadZoneLeft = controller.deviceType == DUALSENSE ? 13 : 13;
-		_info.stickInfo.deadZoneRight = controller.deviceType == DUALSENSE ? 13 : 13;
-		_info.connectionType = SCE_PAD_CONNECTION_TYPE_LOCAL;
-		_info.connectedCount = 1;
-		_info.connected = controller.valid;
-		_info.deviceClass = SCE_PAD_DEVICE_CLASS_STANDARD;
+	s_ScePadInfo _info = {};
 
-		*info = _info;
-		return SCE_OK;
-	}
-	return SCE_PAD_ERROR_INVALID_HANDLE;
+	_info.touchPadInfo.resolution.x = controller.deviceType == DUALSENSE ? 1920 : 1920;
+	_info.touchPadInfo.resolution.y = controller.deviceType == DUALSENSE ? 1080 : 943;
+	_info.touchPadInfo.pixelDensity = controller.deviceType == DUALSENSE ? 44.86 : 44;
+	_info.stickInfo.deadZoneLeft = controller.deviceType == DUALSENSE ? 13 : 13;
+	_info.stickInfo.deadZoneRight = controller.deviceType == DUALSENSE ? 13 : 13;
+	_info.connectionType = SCE_PAD_CONNECTION_TYPE_LOCAL;
+	_info.connectedCount = 1;
+	_info.connected = controller.isLive();
+	_info.deviceClass = SCE_PAD_DEVICE_CLASS_STANDARD;
+
+	*info = _info;
+	return SCE_OK;
 }
 
 int scePadGetControllerType(int handle, s_SceControllerType* controllerType) {
 	if (!g_initialized) return SCE_PAD_ERROR_NOT_INITIALIZED;
 
-	for (auto& controller : g_controllers) {
-		std::shared_lock guard(controller.lock);
+	auto* slot = getController(handle);
+	if (!slot) return SCE_PAD_ERROR_INVALID_HANDLE;
 
-		if (controller.sceHandle != handle) continue;
-		if (!controller.valid) return SCE_PAD_ERROR_DEVICE_NOT_CONNECTED;
+	auto& controller = *slot;
+	std::shared_lock guard(controller.lock);
 
-		*controllerType = (s_SceControllerType)controller.deviceType;
+	if (!controller.isLive()) return SCE_PAD_ERROR_DEVICE_NOT_CONNECTED;
 
-		return SCE_OK;
-	}
-	return SCE_PAD_ERROR_INVALID_HANDLE;
+	*controllerType = (s_SceControllerType)controller.deviceType;
+
+	return SCE_OK;
 }
 
 int scePadGetJackState(int handle, int* state) {
 	if (!g_initialized) return SCE_PAD_ERROR_NOT_INITIALIZED;
 
-	for (auto& controller : g_controllers) {
-		std::shared_lock guard(controller.lock);
+	auto* slot = getController(handle);
+	if (!slot) return SCE_PAD_ERROR_INVALID_HANDLE;
 
-		if (controller.sceHandle != handle) continue;
-		if (!controller.valid) return SCE_PAD_ERROR_DEVICE_NOT_CONNECTED;
+	auto& controller = *slot;
+	std::shared_lock guard(controller.lock);
 
-		if (controller.deviceType == DUALSENSE) {
-			*state = controller.dualsenseCurInputState.PluggedHeadphones + controller.dualsenseCurInputState.PluggedMic;
-		}
-		else if (controller.deviceType == DUALSHOCK4) {
-			*state = controller.dualshock4CurInputState.PluggedHeadphones + controller.dualshock4CurInputState.PluggedMic;
-		}
+	if (!controller.isLive()) return SCE_PAD_ERROR_DEVICE_NOT_CONNECTED;
 
-		return SCE_OK;
+	if (controller.deviceType == DUALSENSE) {
+		*state = controller.dualsenseCurInputState.PluggedHeadphones + controller.dualsenseCurInputState.PluggedMic;
 	}
-	return SCE_PAD_ERROR_INVALID_HANDLE;
+	else if (controller.deviceType == DUALSHOCK4) {
+		*state = controller.dualshock4CurInputState.PluggedHeadphones + controller.dualshock4CurInputState.PluggedMic;
+	}
+
+	return SCE_OK;
 }
 
 int scePadGetTriggerEffectState(int handle, int state[2]) {
 	if (!g_initialized) return SCE_PAD_ERROR_NOT_INITIALIZED;
 
-	for (auto& controller : g_controllers) {
-		std::shared_lock guard(controller.lock);
+	auto* slot = getController(handle);
+	if (!slot) return SCE_PAD_ERROR_INVALID_HANDLE;
 
-		if (controller.sceHandle != handle) continue;
-		if (!controller.valid) return SCE_PAD_ERROR_DEVICE_NOT_CONNECTED;
-		if (controller.deviceType != DUALSENSE) return SCE_PAD_ERROR_NOT_PERMITTED;
-
-		switch (controller.dualsenseCurInputState.TriggerLeftEffect) {
-			case 1:
-				switch (controller.dualsenseCurInputState.TriggerLeftStatus) {
-					case 0:
-						state[0] = SCE_PAD_TRIGGER_STATE_FEEDBACK_NO_FORCE;
-						break;
-					case 1:
-						state[0] = SCE_PAD_TRIGGER_STATE_FEEDBACK_IS_PUSHING;
-						break;
-				}
-				break;
-			case 2:
-				switch (controller.dualsenseCurInputState.TriggerLeftStatus) {
-					case 0:
-						state[0] = SCE_PAD_TRIGGER_STATE_WEAPON_NOT_PRESSED;
-						break;
-					case 1:
-						state[0] = SCE_PAD_TRIGGER_STATE_WEAPON_ALMOST_PRESSED;
-						break;
-					case 2:
-						state[0] = SCE_PAD_TRIGGER_STATE_WEAPON_FULLY_PRESSED;
-						break;
-				}
-				break;
-			case 3:
-				switch (controller.dualsenseCurInputState.TriggerLeftStatus) {
-					case 0:
-						state[0] = SCE_PAD_TRIGGER_STATE_VIBRATION_NOT_FIRING;
-						break;
-					case 1:
-						state[0] = SCE_PAD_TRIGGER_STATE_VIBRATION_IS_FIRING;
-						break;
-				}
-				break;
-		}
+	auto& controller = *slot;
+	std::shared_lock guard(controller.lock);
 
-		switch (controller.dualsenseCurInputState.TriggerRightEffect) {
-			case 1:
-				switch (controller.dualsenseCurInputState.TriggerRightStatus) {
-					case 0:
-						state[1] = SCE_PAD_TRIGGER_STATE_FEEDBACK_NO_FORCE;
-						break;
-					case 1:
-						state[1] = SCE_PAD_TRIGGER_STATE_FEEDBACK_IS_PUSHING;
-						break;
-				}
-				break;
-			case 2:
-				switch (controller.dualsenseCurInputState.TriggerRightStatus) {
-					case 0:
-						state[1] = SCE_PAD_TRIGGER_STATE_WEAPON_NOT_PRESSED;
-						break;
-					case 1:
-						state[1] = SCE_PAD_TRIGGER_STATE_WEAPON_ALMOST_PRESSED;
-						break;
-					case 2:
-						state[1] = SCE_PAD_TRIGGER_STATE_WEAPON_FULLY_PRESSED;
-						break;
-				}
-				break;
-			case 3:
-				switch (controller.dualsenseCurInputState.TriggerRightStatus) {
-					case 0:
-						state[1] = SCE_PAD_TRIGGER_STATE_VIBRATION_NOT_FIRING;
-						break;
-					case 1:
-						state[1] = SCE_PAD_TRIGGER_STATE_VIBRATION_IS_FIRING;
-						break;
-				}
-				break;
-		}
+	if (!controller.isLive()) return SCE_PAD_ERROR_DEVICE_NOT_CONNECTED;
+	if (controller.deviceType != DUALSENSE) return SCE_PAD_ERROR_NOT_PERMITTED;
 
+	switch (controller.dualsenseCurInputState.TriggerLeftEffect) {
+		case 1:
+			switch (controller.dualsenseCurInputState.TriggerLeftStatus) {
+				case 0:
+					state[0] = SCE_PAD_TRIGGER_STATE_FEEDBACK_NO_FORCE;
+					break;
+				case 1:
+					state[0] = SCE_PAD_TRIGGER_STATE_FEEDBACK_IS_PUSHING;
+					break;
+			}
+			break;
+		case 2:
+			switch (controller.dualsenseCurInputState.TriggerLeftStatus) {
+				case 0:
+					state[0] = SCE_PAD_TRIGGER_STATE_WEAPON_NOT_PRESSED;
+					break;
+				case 1:
+					state[0] = SCE_PAD_TRIGGER_STATE_WEAPON_ALMOST_PRESSED;
+					break;
+				case 2:
+					state[0] = SCE_PAD_TRIGGER_STATE_WEAPON_FULLY_PRESSED;
+					break;
+			}
+			break;
+		case 3:
+			switch (controller.dualsenseCurInputState.TriggerLeftStatus) {
+				case 0:
+					state[0] = SCE_PAD_TRIGGER_STATE_VIBRATION_NOT_FIRING;
+					break;
+				case 1:
+					state[0] = SCE_PAD_TRIGGER_STATE_VIBRATION_IS_FIRING;
+					break;
+			}
+			break;
+	}
 
-		return SCE_OK;
+	switch (controller.dualsenseCurInputState.TriggerRightEffect) {
+		case 1:
+			switch (controller.dualsenseCurInputState.TriggerRightStatus) {
+				case 0:
+					state[1] = SCE_PAD_TRIGGER_STATE_FEEDBACK_NO_FORCE;
+					break;
+				case 1:
+					state[1] = SCE_PAD_TRIGGER_STATE_FEEDBACK_IS_PUSHING;
+					break;
+			}
+			break;
+		case 2:
+			switch (controller.dualsenseCurInputState.TriggerRightStatus) {
+				case 0:
+					state[1] = SCE_PAD_TRIGGER_STATE_WEAPON_NOT_PRESSED;
+					break;
+				case 1:
+					state[1] = SCE_PAD_TRIGGER_STATE_WEAPON_ALMOST_PRESSED;
+					break;
+				case 2:
+					state[1] = SCE_PAD_TRIGGER_STATE_WEAPON_FULLY_PRESSED;
+					break;
+			}
+			break;
+		case 3:
+			switch (controller.dualsenseCurInputState.TriggerRightStatus) {
+				case 0:
+					state[1] = SCE_PAD_TRIGGER_STATE_VIBRATION_NOT_FIRING;
+					break;
+				case 1:
+					state[1] = SCE_PAD_TRIGGER_STATE_VIBRATION_IS_FIRING;
+					break;
+			}
+			break;
 	}
-	return SCE_PAD_ERROR_INVALID_HANDLE;
+
+
+	return SCE_OK;
 }
 
 int scePadIsControllerUpdateRequired(int handle) {
 	if (!g_initialized) return SCE_PAD_ERROR_NOT_INITIALIZED;
 
-	for (auto& controller : g_controllers) {
-		std::shared_lock guard(controller.lock);
+	auto* slot = getController(handle);
+	if (!slot) return SCE_PAD_ERROR_INVALID_HANDLE;
 
-		if (controller.sceHandle != handle) continue;
-		if (!controller.valid) return SCE_PAD_ERROR_DEVICE_NOT_CONNECTED;
-		if (controller.productID != DUALSENSE_DEVICE_ID && controller.productID != DUALSENSE_EDGE_DEVICE_ID) return -2137915385LL; // undocumented error
+	auto& controller = *slot;
+	std::shared_lock guard(controller.lock);
 
-		if (controller.productID == DUALSENSE_DEVICE_ID && controller.versionReport.UpdateVersion < 0x390u) {
-			return SCE_PAD_UPDATE_REQUIRED;
-		}
+	if (!controller.isLive()) return SCE_PAD_ERROR_DEVICE_NOT_CONNECTED;
+	if (controller.productID != DUALSENSE_DEVICE_ID && controller.productID != DUALSENSE_EDGE_DEVICE_ID) return -2137915385LL; // undocumented error
 
-		if (controller.productID == DUALSENSE_EDGE_DEVICE_ID && controller.versionReport.UpdateVersion < 0x150u) {
-			return SCE_PAD_UPDATE_REQUIRED;
-		}
+	if (controller.productID == DUALSENSE_DEVICE_ID && controller.versionReport.UpdateVersion < 0x390u) {
+		return SCE_PAD_UPDATE_REQUIRED;
+	}
 
-		return SCE_PAD_UPDATE_NOT_REQUIRED;
+	if (controller.productID == DUALSENSE_EDGE_DEVICE_ID && controller.versionReport.UpdateVersion < 0x150u) {
+		return SCE_PAD_UPDATE_REQUIRED;
 	}
-	return SCE_PAD_ERROR_INVALID_HANDLE;
+
+	return SCE_PAD_UPDATE_NOT_REQUIRED;
 }
 
 int scePadRead(int handle, s_ScePadData* data, int count) {
@@ -1023,218 +1573,249 @@ int scePadRead(int handle, s_ScePadData* data, int count) {
 int scePadResetOrientation(int handle) {
 	if (!g_initialized) return SCE_PAD_ERROR_NOT_INITIALIZED;
 
-	for (auto& controller : g_controllers) {
-		std::shared_lock guard(controller.lock);
+	auto* slot = getController(handle);
+	if (!slot) return SCE_PAD_ERROR_INVALID_HANDLE;
 
-		if (controller.sceHandle != handle) continue;
-		if (!controller.valid) return SCE_PAD_ERROR_DEVICE_NOT_CONNECTED;
+	auto& controller = *slot;
+	std::shared_lock guard(controller.lock);
 
-		controller.orientation = { 0.0f,0.0f,0.0f,1.0f };
+	if (!controller.isLive()) return SCE_PAD_ERROR_DEVICE_NOT_CONNECTED;
 
-		return SCE_OK;
-	}
+	controller.orientationReset = true;
 
-	return SCE_PAD_ERROR_INVALID_HANDLE;
+	return SCE_OK;
 }
 
 int scePadSetAngularVelocityDeadbandState(int handle, bool state) {
 	if (!g_initialized) return SCE_PAD_ERROR_NOT_INITIALIZED;
 
-	for (auto& controller : g_controllers) {
-		std::shared_lock guard(controller.lock);
+	auto* slot = getController(handle);
+	if (!slot) return SCE_PAD_ERROR_INVALID_HANDLE;
 
-		if (controller.sceHandle != handle) continue;
-		if (!controller.valid) return SCE_PAD_ERROR_DEVICE_NOT_CONNECTED;
+	auto& controller = *slot;
+	std::shared_lock guard(controller.lock);
 
-		controller.velocityDeadband = state;
+	if (!controller.isLive()) return SCE_PAD_ERROR_DEVICE_NOT_CONNECTED;
 
-		return SCE_OK;
-	}
+	controller.velocityDeadband = state;
+
+	return SCE_OK;
+}
+
+int scePadSetGyroBiasEstimationState(int handle, bool state) {
+	if (!g_initialized) return SCE_PAD_ERROR_NOT_INITIALIZED;
+
+	auto* slot = getController(handle);
+	if (!slot) return SCE_PAD_ERROR_INVALID_HANDLE;
+
+	auto& controller = *slot;
+	std::shared_lock guard(controller.lock);
 
-	return SCE_PAD_ERROR_INVALID_HANDLE;
+	if (!controller.isLive()) return SCE_PAD_ERROR_DEVICE_NOT_CONNECTED;
+
+	controller.gyroBiasEstimation = state;
+
+	return SCE_OK;
 }
 
 int scePadSetAudioOutPath(int handle, int path) {
 	if (!g_initialized) return SCE_PAD_ERROR_NOT_INITIALIZED;
 	if (path > 4) return SCE_PAD_ERROR_INVALID_ARG;
 
-	for (auto& controller : g_controllers) {
-		std::shared_lock guard(controller.lock);
+	auto* slot = getController(handle);
+	if (!slot) return SCE_PAD_ERROR_INVALID_HANDLE;
 
-		if (controller.sceHandle != handle) continue;
-		if (!controller.valid) return SCE_PAD_ERROR_DEVICE_NOT_CONNECTED;
+	auto& controller = *slot;
 
-		if (controller.deviceType == DUALSENSE) {
-			controller.dualsenseCurOutputState.OutputPathSelect = path;
-		}
-		else if (controller.deviceType == DUALSHOCK4) {
-			controller.dualshock4CurAudio.Output = (dualshock4Data::AudioOutput)path;
-		}
+	if (!controller.isLive()) return SCE_PAD_ERROR_DEVICE_NOT_CONNECTED;
 
-		return SCE_OK;
-	}
+	duaLibUtils::outputCommand command = {};
+	command.type = duaLibUtils::outputCommandType::AudioOutPath;
+	command.values[0] = static_cast<uint8_t>(path);
 
-	return SCE_PAD_ERROR_INVALID_HANDLE;
+	return controller.commands.push(command) ? SCE_OK : SCE_PAD_ERROR_SEND_AGAIN;
 }
 
 int scePadSetMotionSensorState(int handle, bool state) {
 	if (!g_initialized) return SCE_PAD_ERROR_NOT_INITIALIZED;
 
-	for (auto& controller : g_controllers) {
-		std::shared_lock guard(controller.lock);
+	auto* slot = getController(handle);
+	if (!slot) return SCE_PAD_ERROR_INVALID_HANDLE;
 
-		if (controller.sceHandle != handle) continue;
-		if (!controller.valid) { return SCE_PAD_ERROR_DEVICE_NOT_CONNECTED; }
+	auto& controller = *slot;
+	std::shared_lock guard(controller.lock);
 
-		controller.motionSensorState = state;
+	if (!controller.isLive()) { return SCE_PAD_ERROR_DEVICE_NOT_CONNECTED; }
 
-		return SCE_OK;
-	}
+	controller.motionSensorState = state;
 
-	return SCE_PAD_ERROR_INVALID_HANDLE;
+	return SCE_OK;
 }
 
 int scePadSetTiltCorrectionState(int handle, bool state) {
 	if (!g_initialized) return SCE_PAD_ERROR_NOT_INITIALIZED;
 
-	for (auto& controller : g_controllers) {
-		std::shared_lock guard(controller.lock);
+	auto* slot = getController(handle);
+	if (!slot) return SCE_PAD_ERROR_INVALID_HANDLE;
 
-		if (controller.sceHandle != handle) continue;
-		if (!controller.valid) return SCE_PAD_ERROR_DEVICE_NOT_CONNECTED;
+	auto& controller = *slot;
+	std::shared_lock guard(controller.lock);
 
-		controller.tiltCorrection = state;
+	if (!controller.isLive()) return SCE_PAD_ERROR_DEVICE_NOT_CONNECTED;
 
-		return SCE_OK;
-	}
+	controller.tiltCorrection = state;
 
-	return SCE_PAD_ERROR_INVALID_HANDLE;
+	return SCE_OK;
 }
 
 int scePadSetVibration(int handle, s_ScePadVibrationParam* vibration) {
 	if (!g_initialized) return SCE_PAD_ERROR_NOT_INITIALIZED;
 
-	for (auto& controller : g_controllers) {
-		std::shared_lock guard(controller.lock);
+	auto* slot = getController(handle);
+	if (!slot) return SCE_PAD_ERROR_INVALID_HANDLE;
 
-		if (controller.sceHandle != handle) continue;
-		if (!controller.valid) return SCE_PAD_ERROR_DEVICE_NOT_CONNECTED;
+	auto& controller = *slot;
 
-		if (controller.deviceType == DUALSENSE) {
-			controller.dualsenseCurOutputState.RumbleEmulationLeft = vibration->largeMotor;
-			controller.dualsenseCurOutputState.RumbleEmulationRight = vibration->smallMotor;
-		}
-		else if (controller.deviceType == DUALSHOCK4) {
-			controller.dualshock4CurOutputState.RumbleLeft = vibration->largeMotor;
-			controller.dualshock4CurOutputState.RumbleRight = vibration->smallMotor;
-		}
+	if (!controller.isLive()) return SCE_PAD_ERROR_DEVICE_NOT_CONNECTED;
 
-		return SCE_OK;
-	}
+	duaLibUtils::outputCommand command = {};
+	command.type = duaLibUtils::outputCommandType::Vibration;
+	command.values[0] = vibration->largeMotor;
+	command.values[1] = vibration->smallMotor;
 
-	return SCE_PAD_ERROR_INVALID_HANDLE;
+	return controller.commands.push(command) ? SCE_OK : SCE_PAD_ERROR_SEND_AGAIN;
 }
 
 int scePadSetVibrationMode(int handle, int mode) {
 	if (!g_initialized) return SCE_PAD_ERROR_NOT_INITIALIZED;
 	if (mode <= 0) return SCE_PAD_ERROR_INVALID_ARG;
 
-	for (auto& controller : g_controllers) {
-		std::shared_lock guard(controller.lock);
+	auto* slot = getController(handle);
+	if (!slot) return SCE_PAD_ERROR_INVALID_HANDLE;
 
-		if (controller.sceHandle != handle) continue;
-		if (!controller.valid) return SCE_PAD_ERROR_DEVICE_NOT_CONNECTED;
+	auto& controller = *slot;
 
-		if (controller.deviceType == DUALSENSE) {
-			if (mode == SCE_PAD_HAPTICS_MODE) {
-				controller.dualsenseCurOutputState.UseRumbleNotHaptics = false;
-				controller.dualsenseCurOutputState.EnableRumbleEmulation = false;
-				controller.dualsenseCurOutputState.EnableImprovedRumbleEmulation = false;
-			}
-			else if (mode == SCE_PAD_RUMBLE_MODE) {
-				controller.dualsenseCurOutputState.UseRumbleNotHaptics = true;
-
-				if (controller.versionReport.FirmwareVersion >= 0x220) {
-					controller.dualsenseCurOutputState.EnableImprovedRumbleEmulation = true;
-				}
-				else {
-					controller.dualsenseCurOutputState.EnableRumbleEmulation = true;
-				}
-			}
-		}
+	if (!controller.isLive()) return SCE_PAD_ERROR_DEVICE_NOT_CONNECTED;
 
-		return SCE_OK;
-	}
-	return SCE_PAD_ERROR_INVALID_HANDLE;
+	duaLibUtils::outputCommand command = {};
+	command.type = duaLibUtils::outputCommandType::VibrationMode;
+	command.values[0] = static_cast<uint8_t>(mode);
+
+	return controller.commands.push(command) ? SCE_OK : SCE_PAD_ERROR_SEND_AGAIN;
 }
 
 int scePadSetVolumeGain(int handle, s_ScePadVolumeGain* gainSettings) {
 	if (!g_initialized) return SCE_PAD_ERROR_NOT_INITIALIZED;
 	if (!gainSettings || ((gainSettings->speakerVolume + 128) <= 126 || (gainSettings->micGain + 128) <= 126 || (gainSettings->headsetVolume + 128) <= 126)) return SCE_PAD_ERROR_INVALID_ARG;
 
-	for (auto& controller : g_controllers) {
-		std::shared_lock guard(controller.lock);
+	auto* slot = getController(handle);
+	if (!slot) return SCE_PAD_ERROR_INVALID_HANDLE;
 
-		if (controller.sceHandle != handle) continue;
-		if (!controller.valid) return SCE_PAD_ERROR_DEVICE_NOT_CONNECTED;
+	auto& controller = *slot;
 
-		if (controller.deviceType == DUALSENSE) {
-			controller.dualsenseCurOutputState.VolumeSpeaker = gainSettings->speakerVolume + 64;
-			controller.dualsenseCurOutputState.VolumeMic = gainSettings->micGain;
-			controller.dualsenseCurOutputState.VolumeHeadphones = gainSettings->headsetVolume + 64;
-		}
-		else if (controller.deviceType == DUALSHOCK4) {
-			controller.dualshock4CurOutputState.VolumeSpeaker = 40 + (int)((gainSettings->speakerVolume / 126.0) * 79);
-			controller.dualshock4CurOutputState.VolumeMic = 40 + (int)((gainSettings->micGain / 100.0) * 79);
-			controller.dualshock4CurOutputState.VolumeLeft = 40 + (int)((gainSettings->headsetVolume / 100.0) * 79);
-			controller.dualshock4CurOutputState.VolumeRight = 40 + (int)((gainSettings->headsetVolume / 100.0) * 79);
-		}
+	if (!controller.isLive()) return SCE_PAD_ERROR_DEVICE_NOT_CONNECTED;
 
-		return SCE_OK;
-	}
-	return SCE_PAD_ERROR_INVALID_HANDLE;
+	duaLibUtils::outputCommand command = {};
+	command.type = duaLibUtils::outputCommandType::VolumeGain;
+	command.values[0] = gainSettings->speakerVolume;
+	command.values[1] = gainSettings->micGain;
+	command.values[2] = gainSettings->headsetVolume;
+
+	return controller.commands.push(command) ? SCE_OK : SCE_PAD_ERROR_SEND_AGAIN;
 }
 
 int scePadIsSupportedAudioFunction(int handle) {
 	if (!g_initialized) return SCE_PAD_ERROR_NOT_INITIALIZED;
 
-	for (auto& controller : g_controllers) {
-		std::shared_lock guard(controller.lock);
+	auto* slot = getController(handle);
+	if (!slot) return SCE_PAD_ERROR_INVALID_HANDLE;
 
-		if (controller.sceHandle != handle) continue;
-		if (!controller.valid) return SCE_PAD_ERROR_DEVICE_NOT_CONNECTED;
+	auto& controller = *slot;
+	std::shared_lock guard(controller.lock);
 
-		// The original function doesn't include DualShock 4 v1 for some reason.
-		if (controller.productID == DUALSHOCK4_DEVICE_ID || controller.productID == DUALSHOCK4V2_DEVICE_ID || controller.productID == DUALSHOCK4_WIRELESS_ADAPTOR_ID || controller.productID == DUALSENSE_DEVICE_ID || controller.productID == DUALSENSE_EDGE_DEVICE_ID) {
-			return 1;
-		}
+	if (!controller.isLive()) return SCE_PAD_ERROR_DEVICE_NOT_CONNECTED;
 
-		return SCE_OK;
+	// The original function doesn't include DualShock 4 v1 for some reason.
+	if (controller.productID == DUALSHOCK4_DEVICE_ID || controller.productID == DUALSHOCK4V2_DEVICE_ID || controller.productID == DUALSHOCK4_WIRELESS_ADAPTOR_ID || controller.productID == DUALSENSE_DEVICE_ID || controller.productID == DUALSENSE_EDGE_DEVICE_ID) {
+		return 1;
 	}
-	return SCE_PAD_ERROR_INVALID_HANDLE;
+
+	return SCE_OK;
 }
 
 int scePadClose(int handle) {
 	if (!g_initialized) return SCE_PAD_ERROR_NOT_INITIALIZED;
 
-	for (auto& controller : g_controllers) {
-		std::shared_lock guard(controller.lock);
+	auto* slot = getController(handle);
+	if (!slot) return SCE_PAD_ERROR_INVALID_HANDLE;
 
-		if (controller.sceHandle != handle) continue;
-		if (!controller.valid) return SCE_PAD_ERROR_DEVICE_NOT_CONNECTED;
+	auto& controller = *slot;
+	std::shared_lock guard(controller.lock);
 
-		controller.opened = false;
-		controller.valid = false;
-		controller.sceHandle = 0;
-		controller.lastPath = "";
-		controller.productID = 0;
-		controller.wasDisconnected = true;
-		controller.macAddress = "";
-		duaLibUtils::letGo(controller.handle, controller.deviceType, controller.connectionType);
+	if (!controller.transition(duaLibUtils::connectionState::Live, duaLibUtils::connectionState::Closed)) return SCE_PAD_ERROR_DEVICE_NOT_CONNECTED;
+	controller.waitIoIdle();
 
-		return SCE_OK;
+	controller.opened = false;
+	controller.sceHandle = 0;
+	controller.lastPath = "";
+	controller.productID = 0;
+	controller.macAddress = "";
+	duaLibUtils::letGo(controller.handle, controller.deviceType, controller.connectionType);
+	duaLibUtils::closeInputFd(controller);
+	wakeReader();
+
+	return SCE_OK;
+}
+
+int scePadGetIoStatistics(s_ScePadIoStatistics* stats) {
+	if (!g_initialized) return SCE_PAD_ERROR_NOT_INITIALIZED;
+	if (!stats) return SCE_PAD_ERROR_INVALID_ARG;
+
+	s_ScePadIoStatistics result = {};
+	float elapsedUs = static_cast<float>(std::max<int64_t>(duaLibUtils::getTimeUs() - g_initTimeUs, 1));
+	uint64_t latencySamples = 0;
+	double latencySumUs = 0.0;
+
+	result.policy = g_ioPolicy;
+	result.cpuUsage = static_cast<float>(g_ioCpuTimeUs) / elapsedUs;
+	result.wakeupsPerSecond = static_cast<float>(g_ioWakeups) * 1000000.0f / elapsedUs;
+
+	for (auto& controller : g_controllers) {
+		duaLibUtils::ioStatistics counters = {};
+		if (!controller.statistics.load(counters)) continue;
+
+		result.reports += counters.reports;
+		result.coalescedReports += counters.coalescedReports;
+		result.maxLatencyUs = std::max(result.maxLatencyUs, counters.latencyMaxUs);
+		latencySamples += counters.latencySamples;
+		latencySumUs += counters.latencySumUs;
+	}
+
+	if (latencySamples > 0) {
+		result.averageLatencyUs = static_cast<float>(latencySumUs / latencySamples);
 	}
-	return SCE_PAD_ERROR_INVALID_HANDLE;
+
+	*stats = result;
+	return SCE_OK;
+}
+
+int scePadGetConnectionStatistics(int handle, s_ScePadConnectionStatistics* stats) {
+	if (!g_initialized) return SCE_PAD_ERROR_NOT_INITIALIZED;
+	if (!stats) return SCE_PAD_ERROR_INVALID_ARG;
+
+	auto* slot = getController(handle);
+	if (!slot) return SCE_PAD_ERROR_INVALID_HANDLE;
+
+	duaLibUtils::ioStatistics counters = {};
+	slot->statistics.load(counters);
+
+	stats->restores = counters.restores;
+	stats->reconnects = counters.reconnects;
+	stats->lastRestoreUs = counters.lastRestoreUs;
+	stats->averageRestoreUs = counters.restores > 0 ? static_cast<float>(counters.totalRestoreUs / counters.restores) : 0.0f;
+	stats->maxRestoreUs = counters.maxRestoreUs;
+
+	return SCE_OK;
 }
 
 #if COMPILE_TO_EXE
@@ -2,6 +2,8 @@
 #include <triggerFactory.h>
 #include <crc.h>
 #include <algorithm>
+#include <chrono>
+#include <ctime>
 
 #if defined(_WIN32) || defined(_WIN64)
 #include <Windows.h>
@@ -19,6 +21,17 @@
 #include <cstdlib>
 #endif
 
+#if defined(__linux__)
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#endif
+
 namespace duaLibUtils {
 
 	void setPlayerLights(duaLibUtils::controller& controller, bool oldStyle) {
@@ -231,10 +244,284 @@ namespace duaLibUtils {
 		return false;
 	}
 
-	bool isValid(hid_device* handle) {
-		if (!handle) return false;
-		unsigned char buf[1] = {};
-		return hid_read(handle, buf, 1) != -1;
+	// On Linux the hidraw node gets its own read-only descriptor so the reader can poll() every controller at once.
+	// hidapi keeps its handle for writes and feature reports. Non hidraw paths (libusb backend) just keep polling through hidapi.
+	bool openInputFd(duaLibUtils::controller& controller, const char* path) {
+		closeInputFd(controller);
+	#if defined(__linux__)
+		if (!path) return false;
+		controller.inputFd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+		return controller.inputFd >= 0;
+	#else
+		return false;
+	#endif
+	}
+
+	void closeInputFd(duaLibUtils::controller& controller) {
+	#if defined(__linux__)
+		if (controller.inputFd >= 0) {
+			close(controller.inputFd);
+		}
+	#endif
+		controller.inputFd = -1;
+	}
+
+	// Returns the size of the report read, 0 if nothing arrived within timeoutMs or -1 on error. A timeout of 0 never blocks.
+	int readInputReport(duaLibUtils::controller& controller, unsigned char* buffer, size_t size, int timeoutMs) {
+	#if defined(__linux__)
+		if (controller.inputFd >= 0) {
+			if (timeoutMs != 0) {
+				pollfd fd = { controller.inputFd, POLLIN, 0 };
+				if (poll(&fd, 1, timeoutMs) == 0) return 0;
+			}
+
+			ssize_t res = read(controller.inputFd, buffer, size);
+			if (res < 0) {
+				if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) return 0;
+				if (errno == ENODEV || errno == EIO) controller.failedReadCount = MAX_FAILED_READS; // hidraw node is gone
+				return -1;
+			}
+			return static_cast<int>(res);
+		}
+	#endif
+		return hid_read_timeout(controller.handle, buffer, size, timeoutMs);
+	}
+
+	int64_t getTimeUs() {
+		return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	int64_t getThreadCpuTimeUs() {
+	#if defined(_WIN32) || defined(_WIN64)
+		FILETIME creation, exit, kernel, user;
+		if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user)) return 0;
+		uint64_t total = ((static_cast<uint64_t>(kernel.dwHighDateTime) << 32) | kernel.dwLowDateTime) +
+			((static_cast<uint64_t>(user.dwHighDateTime) << 32) | user.dwLowDateTime);
+		return static_cast<int64_t>(total / 10); // 100ns units
+	#else
+		timespec time = {};
+		clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+		return static_cast<int64_t>(time.tv_sec) * 1000000 + time.tv_nsec / 1000;
+	#endif
+	}
+
+	// deviceDeltaUs is the device clock difference between the newest report and the previously published one,
+	// reportCount how many reports were drained in between. The device clock doesn't jitter like host arrival times do.
+	void trackReport(duaLibUtils::controller& controller, uint32_t deviceDeltaUs, uint32_t reportCount) {
+		auto& timing = controller.timing;
+		int64_t now = getTimeUs();
+		int64_t arrival = now;
+
+		if (timing.reports > 0 && reportCount > 0) {
+			float interval = static_cast<float>(deviceDeltaUs) / reportCount;
+
+			// Anything outside 100us-20ms is a reconnect or a clock reset, not the cadence
+			if (interval >= 100.0f && interval <= 20000.0f) {
+				timing.intervalUs = timing.intervalUs == 0.0f ? interval : timing.intervalUs + (interval - timing.intervalUs) / 16.0f;
+			}
+		}
+
+		// A report can't be picked up before it arrives, so the earliest pickups relative to the cadence mark the real
+		// arrival phase. How far behind that phase a report got picked up is its report-to-visible latency.
+		if (timing.intervalUs > 0.0f && timing.lastArrivalUs != 0) {
+			float expected = static_cast<float>(timing.lastArrivalUs) + timing.intervalUs * reportCount;
+			float lag = static_cast<float>(now) - expected;
+
+			if (lag >= -timing.intervalUs / 2.0f && lag <= timing.intervalUs * 4.0f) {
+				if (lag < 0.0f) {
+					lag = 0.0f;
+				}
+				else {
+					arrival = static_cast<int64_t>(expected + lag / 64.0f); // follow host/device clock drift slowly
+				}
+
+				timing.latencySamples++;
+				timing.latencySumUs += lag;
+				timing.latencyMaxUs = std::max(timing.latencyMaxUs, lag);
+			}
+		}
+
+		timing.lastArrivalUs = arrival;
+		timing.reports += reportCount;
+	}
+
+	// Runs on the I/O thread at a report boundary, so the output state is only ever touched by one thread
+	void applyCommands(duaLibUtils::controller& controller) {
+		duaLibUtils::outputCommand command = {};
+		auto& dualsense = controller.dualsenseCurOutputState;
+		auto& dualshock4 = controller.dualshock4CurOutputState;
+
+		while (controller.commands.pop(command)) {
+			switch (command.type) {
+			case outputCommandType::LightBar:
+				if (controller.deviceType == DUALSENSE) {
+					dualsense.LedRed = command.values[0];
+					dualsense.LedGreen = command.values[1];
+					dualsense.LedBlue = command.values[2];
+				}
+				else if (controller.deviceType == DUALSHOCK4) {
+					dualshock4.LedRed = command.values[0];
+					dualshock4.LedGreen = command.values[1];
+					dualshock4.LedBlue = command.values[2];
+				}
+				break;
+			case outputCommandType::PlayerColor:
+				dualshock4.LedRed = command.values[0];
+				dualshock4.LedGreen = command.values[1];
+				dualshock4.LedBlue = command.values[2];
+				break;
+			case outputCommandType::Vibration:
+				if (controller.deviceType == DUALSENSE) {
+					dualsense.RumbleEmulationLeft = command.values[0];
+					dualsense.RumbleEmulationRight = command.values[1];
+				}
+				else if (controller.deviceType == DUALSHOCK4) {
+					dualshock4.RumbleLeft = command.values[0];
+					dualshock4.RumbleRight = command.values[1];
+				}
+				break;
+			case outputCommandType::VibrationMode:
+				if (controller.deviceType != DUALSENSE) break;
+
+				if (command.values[0] == SCE_PAD_HAPTICS_MODE) {
+					dualsense.UseRumbleNotHaptics = false;
+					dualsense.EnableRumbleEmulation = false;
+					dualsense.EnableImprovedRumbleEmulation = false;
+				}
+				else if (command.values[0] == SCE_PAD_RUMBLE_MODE) {
+					dualsense.UseRumbleNotHaptics = true;
+
+					if (controller.versionReport.FirmwareVersion >= 0x220) {
+						dualsense.EnableImprovedRumbleEmulation = true;
+					}
+					else {
+						dualsense.EnableRumbleEmulation = true;
+					}
+				}
+				break;
+			case outputCommandType::TriggerEffect:
+				controller.triggerMask |= command.triggerMask;
+				if (command.triggerMask & SCE_PAD_TRIGGER_EFFECT_TRIGGER_MASK_L2) controller.L2 = command.L2;
+				if (command.triggerMask & SCE_PAD_TRIGGER_EFFECT_TRIGGER_MASK_R2) controller.R2 = command.R2;
+				break;
+			case outputCommandType::VolumeGain: {
+				uint8_t speaker = command.values[0];
+				uint8_t mic = command.values[1];
+				uint8_t headset = command.values[2];
+
+				if (controller.deviceType == DUALSENSE) {
+					dualsense.VolumeSpeaker = speaker + 64;
+					dualsense.VolumeMic = mic;
+					dualsense.VolumeHeadphones = headset + 64;
+				}
+				else if (controller.deviceType == DUALSHOCK4) {
+					dualshock4.VolumeSpeaker = 40 + (int)((speaker / 126.0) * 79);
+					dualshock4.VolumeMic = 40 + (int)((mic / 100.0) * 79);
+					dualshock4.VolumeLeft = 40 + (int)((headset / 100.0) * 79);
+					dualshock4.VolumeRight = 40 + (int)((headset / 100.0) * 79);
+				}
+				break;
+			}
+			case outputCommandType::AudioOutPath:
+				if (controller.deviceType == DUALSENSE) {
+					dualsense.OutputPathSelect = command.values[0];
+				}
+				else if (controller.deviceType == DUALSHOCK4) {
+					controller.dualshock4CurAudio.Output = (dualshock4Data::AudioOutput)command.values[0];
+				}
+				break;
+			}
+		}
+	}
+
+	// Called once the full output state replay after a bring-up made it to the device
+	void trackRestore(duaLibUtils::controller& controller) {
+		auto& restore = controller.restore;
+		if (restore.startUs == 0) return;
+
+		float elapsed = static_cast<float>(getTimeUs() - restore.startUs);
+		restore.startUs = 0;
+		restore.restores++;
+		restore.lastUs = elapsed;
+		restore.maxUs = std::max(restore.maxUs, elapsed);
+		restore.totalUs += elapsed;
+	}
+
+	// Called by whoever moved the slot into state. Empty and Closed are never queued, only the game gets a slot there.
+	void pushConnectionEvent(duaLibUtils::controller& controller, connectionState state) {
+		s_ScePadConnectionEvent event = {};
+
+		switch (state) {
+		case connectionState::Opening: event.state = SCE_PAD_CONNECTION_OPENING; break;
+		case connectionState::Reconnecting: event.state = SCE_PAD_CONNECTION_RECONNECTING; break;
+		case connectionState::Live: event.state = SCE_PAD_CONNECTION_LIVE; break;
+		case connectionState::Lost: event.state = SCE_PAD_CONNECTION_LOST; break;
+		default: return;
+		}
+
+		event.timestamp = static_cast<uint64_t>(getTimeUs());
+		controller.connectionEvents.push(event); // full until the game polls, newer events are dropped
+	}
+
+	// The counters above are only ever written by the I/O thread, getters read this copy instead
+	void publishStatistics(duaLibUtils::controller& controller) {
+		ioStatistics statistics = {};
+		statistics.reports = controller.timing.reports;
+		statistics.coalescedReports = controller.coalescedReports;
+		statistics.latencySamples = controller.timing.latencySamples;
+		statistics.latencySumUs = controller.timing.latencySumUs;
+		statistics.latencyMaxUs = controller.timing.latencyMaxUs;
+		statistics.restores = controller.restore.restores;
+		statistics.reconnects = controller.restore.reconnects;
+		statistics.lastRestoreUs = controller.restore.lastUs;
+		statistics.maxRestoreUs = controller.restore.maxUs;
+		statistics.totalRestoreUs = controller.restore.totalUs;
+		controller.statistics.store(statistics);
+	}
+
+	// Host time the next report should show up at, or 0 when the cadence isn't known or was lost
+	int64_t predictNextReport(const duaLibUtils::controller& controller, int64_t nowUs) {
+		const auto& timing = controller.timing;
+		if (timing.intervalUs <= 0.0f || timing.lastArrivalUs == 0) return 0;
+
+		float expected = static_cast<float>(timing.lastArrivalUs) + timing.intervalUs;
+		for (int missed = 0; expected + timing.intervalUs / 2.0f < nowUs; missed++) {
+			if (missed >= 8) return 0;
+			expected += timing.intervalUs;
+		}
+
+		return static_cast<int64_t>(expected);
+	}
+
+	void setThreadAffinity(uint32_t mask) {
+		if (!mask) return;
+
+	#if defined(_WIN32) || defined(_WIN64)
+		SetThreadAffinityMask(GetCurrentThread(), mask);
+	#elif defined(__linux__)
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		for (int cpu = 0; cpu < 32; cpu++) {
+			if (mask & (1u << cpu)) CPU_SET(cpu, &set);
+		}
+		pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+	#endif
+	}
+
+	// Failures (e.g. no CAP_SYS_NICE for SCHED_FIFO) are ignored, the thread just keeps its current class
+	void setThreadScheduling(uint8_t policy, int8_t priority) {
+	#if defined(__linux__)
+		if (policy == SCE_PAD_IO_SCHED_FIFO) {
+			sched_param param = {};
+			param.sched_priority = std::clamp<int>(priority, sched_get_priority_min(SCHED_FIFO), sched_get_priority_max(SCHED_FIFO));
+			pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+		}
+		else if (policy == SCE_PAD_IO_SCHED_OTHER) {
+			sched_param param = {};
+			pthread_setschedparam(pthread_self(), SCHED_OTHER, &param);
+			setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), std::clamp<int>(priority, -20, 19));
+		}
+	#endif
 	}
 
 #if defined(_WIN32) || defined(_WIN64)
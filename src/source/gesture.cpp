@@ -0,0 +1,205 @@
+#include <gesture.hpp>
+#include <motion.hpp>
+#include <algorithm>
+#include <cmath>
+
+namespace duaLibUtils {
+	static float length(const s_SceFVector3& v) {
+		return std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+	}
+
+	// Axis with the largest component and its sign
+	static void dominantAxis(const s_SceFVector3& v, uint8_t& axis, int8_t& direction) {
+		float components[3] = { v.x, v.y, v.z };
+		axis = 0;
+		for (uint8_t i = 1; i < 3; i++) {
+			if (std::fabs(components[i]) > std::fabs(components[axis])) axis = i;
+		}
+		direction = components[axis] < 0.0f ? -1 : 1;
+	}
+
+	static void loadGestureConfig(duaLibUtils::controller& controller) {
+		s_ScePadGestureConfig config = {};
+		{
+			std::lock_guard guard(controller.gestureLock);
+			config = controller.gestureConfig;
+		}
+
+		if (config.shakeThreshold <= 0.0f) config.shakeThreshold = GESTURE_DEFAULT_SHAKE_THRESHOLD;
+		if (config.shakeCount == 0) config.shakeCount = GESTURE_DEFAULT_SHAKE_COUNT;
+		if (config.shakeWindowUs == 0) config.shakeWindowUs = GESTURE_DEFAULT_SHAKE_WINDOW_US;
+		if (config.tapThreshold <= 0.0f) config.tapThreshold = GESTURE_DEFAULT_TAP_THRESHOLD;
+		if (config.tapMaxUs == 0) config.tapMaxUs = GESTURE_DEFAULT_TAP_MAX_US;
+		if (config.flickThreshold <= 0.0f) config.flickThreshold = GESTURE_DEFAULT_FLICK_THRESHOLD;
+		if (config.flickMaxUs == 0) config.flickMaxUs = GESTURE_DEFAULT_FLICK_MAX_US;
+		if (config.twistAngle <= 0.0f) config.twistAngle = GESTURE_DEFAULT_TWIST_ANGLE;
+		if (config.cooldownUs == 0) config.cooldownUs = GESTURE_DEFAULT_COOLDOWN_US;
+
+		controller.gestures.config = config;
+	}
+
+	static void emitGesture(duaLibUtils::controller& controller, int index, const s_SceFVector3& vector, float magnitude) {
+		auto& state = controller.gestures;
+		uint32_t type = 1u << index;
+		if (!(state.config.enabledGestures & type) || state.timeUs < state.cooldownUntilUs[index]) return;
+
+		s_ScePadGestureEvent event = {};
+		event.type = type;
+		dominantAxis(vector, event.axis, event.direction);
+		event.magnitude = magnitude;
+		event.timestamp = static_cast<uint64_t>(getTimeUs());
+
+		controller.gestureEvents.push(event); // full until the game polls, newer events are dropped
+		state.cooldownUntilUs[index] = state.timeUs + state.config.cooldownUs;
+	}
+
+	// Strokes above the threshold, each one pointing roughly opposite to the previous, with short gaps between them
+	static void detectShake(duaLibUtils::controller& controller, const s_SceFVector3& linear, float magnitude) {
+		auto& state = controller.gestures;
+		float threshold = state.config.shakeThreshold;
+
+		if (!state.shakeStroke && magnitude > threshold) {
+			s_SceFVector3 direction = { linear.x / magnitude, linear.y / magnitude, linear.z / magnitude };
+			const auto& previous = state.shakeDirection;
+			float dot = direction.x * previous.x + direction.y * previous.y + direction.z * previous.z;
+
+			if (state.timeUs - state.shakeLastUs > state.config.shakeWindowUs || state.shakeSequenceUs == 0) {
+				state.shakeSequenceUs = state.timeUs;
+				state.shakeReversals = 0;
+				state.shakePeak = 0.0f;
+			}
+			else if (dot < 0.0f) {
+				state.shakeReversals++;
+			}
+
+			state.shakeStroke = true;
+			state.shakeDirection = direction;
+			state.tapPending = false; // that tap was the start of a shake
+		}
+
+		if (!state.shakeStroke) return;
+
+		state.shakeLastUs = state.timeUs;
+		state.shakePeak = std::max(state.shakePeak, magnitude);
+		if (magnitude < threshold * GESTURE_RELEASE_RATIO) state.shakeStroke = false;
+
+		if (state.shakeReversals >= state.config.shakeCount) {
+			emitGesture(controller, 0, state.shakeDirection, state.shakePeak);
+			state.shakeReversals = 0;
+			state.shakePeak = 0.0f;
+		}
+	}
+
+	// A spike that is over before a shake stroke or a swing could be. With shake on it's only reported once no
+	// second stroke followed within the shake window.
+	static void detectTap(duaLibUtils::controller& controller, const s_SceFVector3& linear, float magnitude) {
+		auto& state = controller.gestures;
+		float threshold = state.config.tapThreshold;
+
+		if (state.tapPending && state.timeUs - state.tapReleaseUs > state.config.shakeWindowUs) {
+			state.tapPending = false;
+			emitGesture(controller, 1, state.tapPeak, length(state.tapPeak));
+		}
+
+		if (!state.tapActive) {
+			if (magnitude <= threshold) return;
+			state.tapActive = true;
+			state.tapStartUs = state.timeUs;
+			state.tapPeak = linear;
+		}
+
+		if (magnitude > length(state.tapPeak)) state.tapPeak = linear;
+		if (magnitude >= threshold * GESTURE_RELEASE_RATIO) return;
+
+		state.tapActive = false;
+		if (state.timeUs - state.tapStartUs > state.config.tapMaxUs) return;
+		if (state.tapStartUs - state.shakeSequenceUs > state.config.tapMaxUs) return; // a later stroke of a shake
+
+		if (state.config.enabledGestures & SCE_PAD_GESTURE_SHAKE) {
+			state.tapPending = true;
+			state.tapReleaseUs = state.timeUs;
+		}
+		else {
+			emitGesture(controller, 1, state.tapPeak, length(state.tapPeak));
+		}
+	}
+
+	// Same as a tap but on the gyro, longer bursts are left to twist
+	static void detectFlick(duaLibUtils::controller& controller) {
+		auto& state = controller.gestures;
+		const auto& w = controller.angularVelocity;
+		float speed = length(w);
+		float threshold = state.config.flickThreshold;
+
+		if (!state.flickActive) {
+			if (speed <= threshold) return;
+			state.flickActive = true;
+			state.flickStartUs = state.timeUs;
+			state.flickPeak = w;
+		}
+
+		if (speed > length(state.flickPeak)) state.flickPeak = w;
+		if (speed >= threshold * GESTURE_RELEASE_RATIO) return;
+
+		state.flickActive = false;
+		if (state.timeUs - state.flickStartUs <= state.config.flickMaxUs) {
+			emitGesture(controller, 2, state.flickPeak, length(state.flickPeak));
+		}
+	}
+
+	// Rotation integrated per axis while that axis dominates, otherwise it unwinds
+	static void detectTwist(duaLibUtils::controller& controller, float deltaTime) {
+		auto& state = controller.gestures;
+		const auto& w = controller.angularVelocity;
+		float components[3] = { w.x, w.y, w.z };
+		float decay = std::max(0.0f, 1.0f - GESTURE_TWIST_DECAY * deltaTime);
+
+		for (int i = 0; i < 3; i++) {
+			float others = std::max(std::fabs(components[(i + 1) % 3]), std::fabs(components[(i + 2) % 3]));
+			bool dominant = components[i] != 0.0f && std::fabs(components[i]) >= others * GESTURE_TWIST_DOMINANCE;
+
+			if (dominant && (state.twistAngle[i] == 0.0f || (state.twistAngle[i] > 0.0f) == (components[i] > 0.0f))) {
+				state.twistAngle[i] += components[i] * deltaTime;
+			}
+			else {
+				state.twistAngle[i] *= decay;
+			}
+
+			if (std::fabs(state.twistAngle[i]) < state.config.twistAngle) continue;
+
+			s_SceFVector3 axis = { i == 0 ? state.twistAngle[i] : 0.0f, i == 1 ? state.twistAngle[i] : 0.0f, i == 2 ? state.twistAngle[i] : 0.0f };
+			emitGesture(controller, 3, axis, std::fabs(state.twistAngle[i]));
+			std::fill(std::begin(state.twistAngle), std::end(state.twistAngle), 0.0f);
+			break;
+		}
+	}
+
+	void updateGestures(duaLibUtils::controller& controller, uint32_t deltaUs) {
+		if (controller.gestureConfigChanged.exchange(false, std::memory_order_acquire)) {
+			loadGestureConfig(controller);
+		}
+
+		auto& state = controller.gestures;
+		if (!state.config.enabledGestures || !controller.motionSensorState.load(std::memory_order_relaxed)) return;
+
+		const auto& g = controller.gravity;
+		if (deltaUs == 0 || deltaUs > MAX_MOTION_GAP_US || (g.x == 0.0f && g.y == 0.0f && g.z == 0.0f)) {
+			// Nothing to measure a duration against, drop whatever was in progress
+			state.shakeStroke = state.tapActive = state.tapPending = state.flickActive = false;
+			state.shakeReversals = 0;
+			std::fill(std::begin(state.twistAngle), std::end(state.twistAngle), 0.0f);
+			return;
+		}
+
+		state.timeUs += deltaUs;
+
+		const auto& a = controller.acceleration;
+		s_SceFVector3 linear = { a.x - g.x, a.y - g.y, a.z - g.z };
+		float magnitude = length(linear);
+
+		detectShake(controller, linear, magnitude);
+		detectTap(controller, linear, magnitude);
+		detectFlick(controller);
+		detectTwist(controller, deltaUs / 1000000.0f);
+	}
+}
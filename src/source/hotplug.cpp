@@ -0,0 +1,178 @@
+#include <hotplug.hpp>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <linux/netlink.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace duaLibUtils {
+	// Listens on the kernel uevent multicast group directly so there's no libudev dependency.
+	// Events arrive before udev applied its rules, callers have to retry opening a freshly added node for a bit.
+	bool openHotplugMonitor(hotplugMonitor& monitor) {
+		closeHotplugMonitor(monitor);
+	#if defined(__linux__)
+		monitor.wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		monitor.socketFd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_KOBJECT_UEVENT);
+		if (monitor.socketFd < 0) return false;
+
+		sockaddr_nl address = {};
+		address.nl_family = AF_NETLINK;
+		address.nl_groups = 1; // kernel events
+
+		if (bind(monitor.socketFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+			close(monitor.socketFd);
+			monitor.socketFd = -1;
+			return false;
+		}
+
+		return true;
+	#else
+		return false;
+	#endif
+	}
+
+	void closeHotplugMonitor(hotplugMonitor& monitor) {
+	#if defined(__linux__)
+		if (monitor.socketFd >= 0) close(monitor.socketFd);
+		if (monitor.wakeFd >= 0) close(monitor.wakeFd);
+	#endif
+		monitor.socketFd = -1;
+		monitor.wakeFd = -1;
+	}
+
+	// Kernel uevents are "action@devpath" followed by NUL separated KEY=value pairs
+	bool parseUevent(const char* buffer, size_t size, hotplugEvent& event) {
+		hotplugEvent parsed = {};
+		bool hidraw = false;
+		size_t offset = 0;
+
+		while (offset < size) {
+			const char* field = buffer + offset;
+			size_t length = strnlen(field, size - offset);
+
+			if (length > 7 && !strncmp(field, "ACTION=", 7)) {
+				if (!strcmp(field + 7, "add")) parsed.action = hotplugAction::Add;
+				else if (!strcmp(field + 7, "remove")) parsed.action = hotplugAction::Remove;
+			}
+			else if (length > 10 && !strncmp(field, "SUBSYSTEM=", 10)) {
+				hidraw = !strcmp(field + 10, "hidraw");
+			}
+			else if (length > 8 && !strncmp(field, "DEVNAME=", 8)) {
+				parsed.devnode = field[8] == '/' ? std::string(field + 8, length - 8) : "/dev/" + std::string(field + 8, length - 8);
+			}
+
+			offset += length + 1;
+		}
+
+		if (!hidraw || parsed.action == hotplugAction::None || parsed.devnode.empty()) return false;
+
+		event = parsed;
+		return true;
+	}
+
+	// Queues a raw uevent as if it came from the kernel, lets the hotplug path run without hardware
+	void injectUevent(hotplugMonitor& monitor, const char* buffer, size_t size) {
+		if (!buffer || size == 0) return;
+
+		{
+			std::lock_guard guard(monitor.injectLock);
+			monitor.injected.emplace_back(buffer, size);
+		}
+
+		wakeHotplugMonitor(monitor);
+	}
+
+	// Makes a pending waitHotplugEvents return right away
+	void wakeHotplugMonitor(hotplugMonitor& monitor) {
+	#if defined(__linux__)
+		if (monitor.wakeFd >= 0) {
+			uint64_t one = 1;
+			(void)write(monitor.wakeFd, &one, sizeof(one));
+		}
+	#else
+		(void)monitor;
+	#endif
+	}
+
+	// Waits up to timeoutMs for hidraw add/remove events, returns false if it timed out without any
+	bool waitHotplugEvents(hotplugMonitor& monitor, int timeoutMs, std::vector<hotplugEvent>& events) {
+		events.clear();
+
+		auto takeInjected = [&]() {
+			std::lock_guard guard(monitor.injectLock);
+			for (auto& uevent : monitor.injected) {
+				hotplugEvent event = {};
+				if (parseUevent(uevent.data(), uevent.size(), event)) events.push_back(event);
+			}
+			monitor.injected.clear();
+		};
+
+	#if defined(__linux__)
+		pollfd fds[2] = {};
+		nfds_t count = 0;
+
+		if (monitor.wakeFd >= 0) fds[count++] = { monitor.wakeFd, POLLIN, 0 };
+		if (monitor.socketFd >= 0) fds[count++] = { monitor.socketFd, POLLIN, 0 };
+
+		if (count == 0) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(timeoutMs));
+		}
+		else if (poll(fds, count, timeoutMs) > 0) {
+			for (nfds_t i = 0; i < count; i++) {
+				if (!(fds[i].revents & POLLIN)) continue;
+
+				if (fds[i].fd == monitor.wakeFd) {
+					uint64_t value = 0;
+					(void)read(monitor.wakeFd, &value, sizeof(value));
+					continue;
+				}
+
+				char buffer[4096];
+				ssize_t size;
+				while ((size = recv(monitor.socketFd, buffer, sizeof(buffer) - 1, 0)) > 0) {
+					buffer[size] = '\0';
+					hotplugEvent event = {};
+					if (parseUevent(buffer, static_cast<size_t>(size), event)) events.push_back(event);
+				}
+			}
+		}
+	#else
+		std::this_thread::sleep_for(std::chrono::milliseconds(timeoutMs));
+	#endif
+
+		takeInjected();
+		return !events.empty();
+	}
+
+	// Adds schedule an immediate scan, removes are handed back so the caller can drop the slot right away
+	void queueHotplugEvents(hotplugQueue& queue, const std::vector<hotplugEvent>& events, int64_t nowUs, std::vector<std::string>& removed) {
+		removed.clear();
+
+		for (auto& event : events) {
+			if (event.action == hotplugAction::Add) {
+				queue.pending.push_back(event.devnode);
+				queue.retryUntilUs = nowUs + HOTPLUG_RETRY_WINDOW_MS * 1000LL;
+				queue.nextScanUs = 0;
+			}
+			else if (event.action == hotplugAction::Remove) {
+				removed.push_back(event.devnode);
+				std::erase(queue.pending, event.devnode);
+			}
+		}
+	}
+
+	// Runs after a scan. udev may not have fixed the node's permissions yet when the add event arrives, so unbound
+	// nodes keep getting rescanned for a bit before falling back to the slow periodic scan.
+	void scheduleHotplugScan(hotplugQueue& queue, int64_t nowUs, int64_t fallbackUs, bool (*isBound)(const std::string& path)) {
+		std::erase_if(queue.pending, isBound);
+		bool retry = !queue.pending.empty() && nowUs < queue.retryUntilUs;
+		queue.nextScanUs = nowUs + (retry ? HOTPLUG_RETRY_MS * 1000LL : fallbackUs);
+	}
+}
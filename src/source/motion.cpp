@@ -0,0 +1,345 @@
+#include <motion.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#define M_PI 3.14159265358979323846
+
+namespace duaLibUtils {
+	static int16_t le16(const unsigned char* data) {
+		return static_cast<int16_t>(data[0] | (data[1] << 8));
+	}
+
+	bool readImuCalibration(hid_device* handle, uint16_t productID, uint8_t connectionType, imuCalibration& calibration) {
+		if (!handle) return false;
+
+		unsigned char buffer[64] = {};
+		if (productID == DUALSENSE_DEVICE_ID || productID == DUALSENSE_EDGE_DEVICE_ID) buffer[0] = DUALSENSE_CALIBRATION_REPORT;
+		else buffer[0] = connectionType == HID_API_BUS_BLUETOOTH ? DUALSHOCK4_CALIBRATION_REPORT_BT : DUALSHOCK4_CALIBRATION_REPORT_USB;
+
+		int res = hid_get_feature_report(handle, buffer, sizeof(buffer));
+		return parseImuCalibration(buffer, res, productID, connectionType, calibration);
+	}
+
+	// Same layout as the Linux hid-playstation driver reads. The gyro bias in the report is already applied by the
+	// firmware, plus/minus are the raw readings at +-gyroSpeed deg/s and the accelerometer's at +-1 g.
+	// Only a DS4 on USB groups the gyro values by sign, over BT and behind the wireless adaptor they're per axis.
+	bool parseImuCalibration(const unsigned char* report, int size, uint16_t productID, uint8_t connectionType, imuCalibration& calibration) {
+		if (size < 35) return false;
+
+		int pitchBias = le16(&report[1]);
+		int yawBias = le16(&report[3]);
+		int rollBias = le16(&report[5]);
+		int pitchPlus, pitchMinus, yawPlus, yawMinus, rollPlus, rollMinus;
+
+		if ((productID == DUALSHOCK4_DEVICE_ID || productID == DUALSHOCK4V2_DEVICE_ID) && connectionType != HID_API_BUS_BLUETOOTH) {
+			pitchPlus = le16(&report[7]);
+			yawPlus = le16(&report[9]);
+			rollPlus = le16(&report[11]);
+			pitchMinus = le16(&report[13]);
+			yawMinus = le16(&report[15]);
+			rollMinus = le16(&report[17]);
+		}
+		else {
+			pitchPlus = le16(&report[7]);
+			pitchMinus = le16(&report[9]);
+			yawPlus = le16(&report[11]);
+			yawMinus = le16(&report[13]);
+			rollPlus = le16(&report[15]);
+			rollMinus = le16(&report[17]);
+		}
+
+		int speed2x = le16(&report[19]) + le16(&report[21]);
+		int gyroRange[3] = { // struct order: pitch, roll, yaw
+			std::abs(pitchPlus - pitchBias) + std::abs(pitchMinus - pitchBias),
+			std::abs(rollPlus - rollBias) + std::abs(rollMinus - rollBias),
+			std::abs(yawPlus - yawBias) + std::abs(yawMinus - yawBias)
+		};
+
+		int accelPlus[3] = { le16(&report[23]), le16(&report[27]), le16(&report[31]) };
+		int accelMinus[3] = { le16(&report[25]), le16(&report[29]), le16(&report[33]) };
+
+		// Some clones send zeros or garbage, keep the defaults then
+		if (speed2x <= 0) return false;
+		for (int i = 0; i < 3; i++) {
+			if (gyroRange[i] <= 0 || accelPlus[i] - accelMinus[i] <= 0) return false;
+		}
+
+		imuCalibration result = {};
+		for (int i = 0; i < 3; i++) {
+			int accelRange = accelPlus[i] - accelMinus[i]; // 2 g
+			result.gyroScale[i] = static_cast<float>(speed2x) / gyroRange[i] * static_cast<float>(M_PI / 180.0);
+			result.gyroBias[i] = 0.0f;
+			result.accelScale[i] = 2.0f / accelRange;
+			result.accelBias[i] = accelPlus[i] - accelRange / 2.0f;
+		}
+		result.factory = true;
+
+		calibration = result;
+		return true;
+	}
+
+	static float deadband(float value, bool enabled) {
+		return enabled && value < ANGULAR_VELOCITY_DEADBAND_MIN && value > -ANGULAR_VELOCITY_DEADBAND_MIN ? 0.0f : value;
+	}
+
+	// Rest detector: the accelerometer barely moving and the bias-corrected gyro reading little more than noise.
+	// While that holds for a while the raw gyro reading is all bias and goes into the temperature fit.
+	static void estimateGyroBias(duaLibUtils::controller& controller, const s_SceFVector3& angularVelocity, float temperature, uint32_t deltaUs) {
+		auto& estimate = controller.gyroBias;
+		const auto& a = controller.acceleration;
+
+		float dx = a.x - estimate.accelMean.x;
+		float dy = a.y - estimate.accelMean.y;
+		float dz = a.z - estimate.accelMean.z;
+		estimate.accelMean.x += dx * REST_STATS_SMOOTHING;
+		estimate.accelMean.y += dy * REST_STATS_SMOOTHING;
+		estimate.accelMean.z += dz * REST_STATS_SMOOTHING;
+		estimate.accelVariance += ((dx * dx + dy * dy + dz * dz) - estimate.accelVariance) * REST_STATS_SMOOTHING;
+
+		float gx = angularVelocity.x - estimate.bias.x;
+		float gy = angularVelocity.y - estimate.bias.y;
+		float gz = angularVelocity.z - estimate.bias.z;
+		bool still = estimate.accelVariance < REST_ACCEL_VARIANCE && gx * gx + gy * gy + gz * gz < REST_GYRO_MAX * REST_GYRO_MAX;
+
+		estimate.restUs = still ? std::min<uint32_t>(estimate.restUs + deltaUs, REST_SETTLE_US) : 0;
+
+		if (estimate.restUs >= REST_SETTLE_US) {
+			double w = deltaUs;
+			double t = temperature;
+			double raw[3] = { angularVelocity.x, angularVelocity.y, angularVelocity.z };
+			double forget = 1.0 - w / REST_BIAS_MEMORY_US;
+
+			estimate.weight = estimate.weight * forget + w;
+			estimate.sumT = estimate.sumT * forget + w * t;
+			estimate.sumTT = estimate.sumTT * forget + w * t * t;
+			for (int i = 0; i < 3; i++) {
+				estimate.sumB[i] = estimate.sumB[i] * forget + w * raw[i];
+				estimate.sumTB[i] = estimate.sumTB[i] * forget + w * t * raw[i];
+			}
+		}
+
+		// Evaluated every report, in motion too, so the bias follows the temperature
+		if (estimate.weight < REST_MIN_WEIGHT_US) return;
+
+		double meanT = estimate.sumT / estimate.weight;
+		double spread = estimate.sumTT / estimate.weight - meanT * meanT;
+		bool fit = spread >= REST_MIN_TEMPERATURE_SPREAD;
+
+		// The line is only known around the temperatures the pad rested at, don't follow it far past them
+		double reach = fit ? REST_MAX_EXTRAPOLATION * std::sqrt(spread) : 0.0;
+		double offset = std::clamp(temperature - meanT, -reach, reach);
+
+		float bias[3];
+		for (int i = 0; i < 3; i++) {
+			double meanB = estimate.sumB[i] / estimate.weight;
+			double slope = fit ? (estimate.sumTB[i] / estimate.weight - meanT * meanB) / spread : 0.0;
+			bias[i] = static_cast<float>(meanB + slope * offset);
+		}
+		estimate.bias = { bias[0], bias[1], bias[2] };
+	}
+
+	// Gravity as the pad sees it: turned with the gyro (a world fixed vector rotates by -w in the body frame) and
+	// pulled towards the accelerometer whenever that reads about 1 g. Independent of the orientation reference, so
+	// scePadResetOrientation doesn't throw it off. Kept in the accelerometer's frame, the gyro's y and z are swapped
+	// against it.
+	static void trackGravity(duaLibUtils::controller& controller, float deltaTime) {
+		auto& g = controller.gravity;
+		const auto& a = controller.acceleration;
+		s_SceFVector3 w = { controller.angularVelocity.x, controller.angularVelocity.z, controller.angularVelocity.y };
+		float length = std::sqrt(a.x * a.x + a.y * a.y + a.z * a.z);
+
+		if (g.x == 0.0f && g.y == 0.0f && g.z == 0.0f) {
+			if (length > 0.0f) g = { a.x / length, a.y / length, a.z / length };
+			return;
+		}
+
+		s_SceFVector3 turned = {
+			g.x - (w.y * g.z - w.z * g.y) * deltaTime,
+			g.y - (w.z * g.x - w.x * g.z) * deltaTime,
+			g.z - (w.x * g.y - w.y * g.x) * deltaTime
+		};
+
+		if (std::fabs(length - 1.0f) <= TILT_ACCEL_TOLERANCE) {
+			float k = std::min(1.0f, GRAVITY_CORRECTION_RATE * deltaTime);
+			turned.x += (a.x - turned.x) * k;
+			turned.y += (a.y - turned.y) * k;
+			turned.z += (a.z - turned.z) * k;
+		}
+
+		float norm = std::sqrt(turned.x * turned.x + turned.y * turned.y + turned.z * turned.z);
+		if (norm > 0.0f) g = { turned.x / norm, turned.y / norm, turned.z / norm };
+	}
+
+	// Mahony: the accelerometer's "up" is compared with the one the orientation predicts, their cross product is
+	// the rotation error. The report puts the yaw rate in AngularVelocityZ, so the integration frame is the
+	// accelerometer's with y and z swapped and physical up (+1 g on y when flat) is z in it. The swap mirrors the
+	// frame, which the published orientation undoes by swapping back, so up as the accelerometer sees it is R * z
+	// rather than R^T * z. The error is found on that side and turned into the body frame for the gyro.
+	static void correctTilt(duaLibUtils::controller& controller, s_SceFVector3& w, float deltaTime) {
+		auto& a = controller.lastAcceleration;
+		a.x += (controller.acceleration.x - a.x) * TILT_ACCEL_SMOOTHING;
+		a.y += (controller.acceleration.y - a.y) * TILT_ACCEL_SMOOTHING;
+		a.z += (controller.acceleration.z - a.z) * TILT_ACCEL_SMOOTHING;
+
+		float length = std::sqrt(a.x * a.x + a.y * a.y + a.z * a.z);
+		if (std::fabs(length - 1.0f) > TILT_ACCEL_TOLERANCE) return; // being shaken, gravity isn't measurable
+
+		// Measured up in the integration frame
+		float tx = a.x / length;
+		float ty = a.z / length;
+		float tz = a.y / length;
+
+		// Rotation matrix columns of the orientation, the third one is the predicted up
+		const auto& q = controller.orientation;
+		s_SceFVector3 c1 = { 1.0f - 2.0f * (q.y * q.y + q.z * q.z), 2.0f * (q.x * q.y + q.w * q.z), 2.0f * (q.x * q.z - q.w * q.y) };
+		s_SceFVector3 c2 = { 2.0f * (q.x * q.y - q.w * q.z), 1.0f - 2.0f * (q.x * q.x + q.z * q.z), 2.0f * (q.y * q.z + q.w * q.x) };
+		s_SceFVector3 v = { 2.0f * (q.x * q.z + q.w * q.y), 2.0f * (q.y * q.z - q.w * q.x), 1.0f - 2.0f * (q.x * q.x + q.y * q.y) };
+
+		float ex = v.y * tz - v.z * ty;
+		float ey = v.z * tx - v.x * tz;
+		float ez = v.x * ty - v.y * tx;
+
+		// R^T * e
+		float bx = c1.x * ex + c1.y * ey + c1.z * ez;
+		float by = c2.x * ex + c2.y * ey + c2.z * ez;
+		float bz = v.x * ex + v.y * ey + v.z * ez;
+
+		controller.eInt[0] += TILT_CORRECTION_KI * bx * deltaTime;
+		controller.eInt[1] += TILT_CORRECTION_KI * by * deltaTime;
+		controller.eInt[2] += TILT_CORRECTION_KI * bz * deltaTime;
+
+		w.x += TILT_CORRECTION_KP * bx + controller.eInt[0];
+		w.y += TILT_CORRECTION_KP * by + controller.eInt[1];
+		w.z += TILT_CORRECTION_KP * bz + controller.eInt[2];
+	}
+
+	void updateMotion(duaLibUtils::controller& controller, const s_SceFVector3& acceleration, const s_SceFVector3& angularVelocity, float temperature, uint32_t deltaUs) {
+		if (controller.orientationReset.load(std::memory_order_relaxed) && controller.orientationReset.exchange(false)) {
+			controller.orientation = { 0.0f,0.0f,0.0f,1.0f };
+			controller.eInt[0] = controller.eInt[1] = controller.eInt[2] = 0.0f;
+		}
+
+		if (!controller.motionSensorState.load(std::memory_order_relaxed)) return;
+
+		controller.acceleration = acceleration;
+
+		bool integrate = deltaUs != 0 && deltaUs <= MAX_MOTION_GAP_US;
+		s_SceFVector3 bias = {};
+		if (controller.gyroBiasEstimation.load(std::memory_order_relaxed)) {
+			if (integrate) estimateGyroBias(controller, angularVelocity, temperature, deltaUs);
+			bias = controller.gyroBias.bias;
+		}
+
+		s_SceFVector3 previous = controller.angularVelocity;
+		bool velocityDeadband = controller.velocityDeadband.load(std::memory_order_relaxed);
+		controller.angularVelocity = {
+			deadband(angularVelocity.x - bias.x, velocityDeadband),
+			deadband(angularVelocity.y - bias.y, velocityDeadband),
+			deadband(angularVelocity.z - bias.z, velocityDeadband)
+		};
+
+		if (!integrate) {
+			controller.angularAcceleration = { 0.0f,0.0f,0.0f };
+			return;
+		}
+		float deltaTime = deltaUs / 1000000.0f;
+
+		trackGravity(controller, deltaTime);
+
+		controller.rotation[0] += controller.angularVelocity.x * deltaTime;
+		controller.rotation[1] += controller.angularVelocity.y * deltaTime;
+		controller.rotation[2] += controller.angularVelocity.z * deltaTime;
+
+		auto& alpha = controller.angularAcceleration;
+		alpha.x += ((controller.angularVelocity.x - previous.x) / deltaTime - alpha.x) * ANGULAR_ACCELERATION_SMOOTHING;
+		alpha.y += ((controller.angularVelocity.y - previous.y) / deltaTime - alpha.y) * ANGULAR_ACCELERATION_SMOOTHING;
+		alpha.z += ((controller.angularVelocity.z - previous.z) / deltaTime - alpha.z) * ANGULAR_ACCELERATION_SMOOTHING;
+
+		s_SceFVector3 w = controller.angularVelocity;
+		if (controller.tiltCorrection.load(std::memory_order_relaxed)) {
+			correctTilt(controller, w, deltaTime);
+		}
+		else {
+			controller.lastAcceleration = controller.acceleration;
+			controller.eInt[0] = controller.eInt[1] = controller.eInt[2] = 0.0f;
+		}
+
+		auto& q = controller.orientation;
+
+		// q' = 0.5 * q * (w, 0)
+		s_SceFQuaternion qDot = {
+			0.5f * (q.w * w.x + q.y * w.z - q.z * w.y),
+			0.5f * (q.w * w.y + q.z * w.x - q.x * w.z),
+			0.5f * (q.w * w.z + q.x * w.y - q.y * w.x),
+			0.5f * (-q.x * w.x - q.y * w.y - q.z * w.z)
+		};
+
+		q.x += qDot.x * deltaTime;
+		q.y += qDot.y * deltaTime;
+		q.z += qDot.z * deltaTime;
+		q.w += qDot.w * deltaTime;
+
+		float norm = std::sqrt(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+		q.x /= norm; q.y /= norm; q.z /= norm; q.w /= norm;
+	}
+
+	void predictState(publishedState& state, float seconds, bool motion) {
+		auto& data = state.data;
+
+		if (motion) {
+			const auto& a = state.angularAcceleration;
+			auto& w = data.angularVelocity;
+
+			// Rotate by the mean rate over the interval, in the integration frame (published y and z are swapped)
+			float rx = (w.x + 0.5f * a.x * seconds) * seconds;
+			float ry = (w.y + 0.5f * a.y * seconds) * seconds;
+			float rz = (w.z + 0.5f * a.z * seconds) * seconds;
+			float angle = std::sqrt(rx * rx + ry * ry + rz * rz);
+
+			if (angle > 0.0f) {
+				float s = std::sin(angle * 0.5f) / angle;
+				s_SceFQuaternion r = { rx * s, ry * s, rz * s, std::cos(angle * 0.5f) };
+				s_SceFQuaternion q = { data.orientation.x, data.orientation.z, data.orientation.y, data.orientation.w };
+
+				s_SceFQuaternion p = {
+					q.w * r.x + q.x * r.w + q.y * r.z - q.z * r.y,
+					q.w * r.y + q.y * r.w + q.z * r.x - q.x * r.z,
+					q.w * r.z + q.z * r.w + q.x * r.y - q.y * r.x,
+					q.w * r.w - q.x * r.x - q.y * r.y - q.z * r.z
+				};
+
+				data.orientation = { p.x, p.z, p.y, p.w };
+			}
+
+			w.x += a.x * seconds;
+			w.y += a.y * seconds;
+			w.z += a.z * seconds;
+		}
+
+		// Soft deadband, a resting stick's noise doesn't get projected but a moving stick's lead doesn't jump either
+		float us = seconds * 1000000.0f;
+		uint8_t* sticks[4] = { &data.LeftStick.X, &data.LeftStick.Y, &data.RightStick.X, &data.RightStick.Y };
+		for (int i = 0; i < 4; i++) {
+			float velocity = state.stickVelocity[i];
+			velocity = std::copysign(std::max(0.0f, std::fabs(velocity) - STICK_VELOCITY_DEADBAND), velocity);
+
+			float value = *sticks[i] + velocity * us;
+			*sticks[i] = static_cast<uint8_t>(std::clamp(value + 0.5f, 0.0f, 255.0f));
+		}
+	}
+
+	// The low pass keeps bounded noise bounded: n LSB of jitter can't push the estimate past
+	// n / (time constant + report interval), whatever the report rate
+	void trackStickVelocity(publishedState& state, const s_ScePadData& last, int64_t elapsedUs) {
+		const auto& data = state.data;
+		int now[4] = { data.LeftStick.X, data.LeftStick.Y, data.RightStick.X, data.RightStick.Y };
+		int before[4] = { last.LeftStick.X, last.LeftStick.Y, last.RightStick.X, last.RightStick.Y };
+		float k = elapsedUs / (STICK_VELOCITY_TIME_CONSTANT_US + elapsedUs);
+
+		for (int i = 0; i < 4; i++) {
+			float velocity = static_cast<float>(now[i] - before[i]) / elapsedUs;
+			state.stickVelocity[i] += (velocity - state.stickVelocity[i]) * k;
+		}
+	}
+}
@@ -2,42 +2,73 @@
 #include <duaLibUtils.hpp>
 #include <crc.h>
 #include <readDualsense.hpp>
+#include <motion.hpp>
+#include <deviceTraits.hpp>
+#include <gesture.hpp>
 #include <algorithm>
 
-bool ReadDualsense(duaLibUtils::controller& controller)
+bool ReadDualsense(duaLibUtils::controller& controller, int timeoutMs)
 {
     bool isBt = controller.connectionType == HID_API_BUS_BLUETOOTH ? true : false;
 
     dualsenseData::ReportIn01USB inputUsb = {};
     dualsenseData::ReportIn31 inputBt = {};
+    dualsenseData::USBGetStateData inputData = {};
 
     int32_t res = -1;
+    uint32_t reportCount = 0;
+    bool muteToggled = false;
+    bool lastMute = controller.dualsenseCurInputState.ButtonMute;
+    uint32_t lastTimestamp = controller.dualsenseCurInputState.SensorTimestamp;
+
+    // Drain everything that queued up since the last pass so a late pass doesn't leave us serving stale input.
+    // Edge triggered logic runs on every report, only the newest one gets published.
+    while (reportCount < MAX_DRAINED_REPORTS)
+    {
+        if (isBt)
+            res = duaLibUtils::readInputReport(controller, reinterpret_cast<unsigned char *>(&inputBt), sizeof(inputBt), reportCount == 0 ? timeoutMs : 0);
+        else
+            res = duaLibUtils::readInputReport(controller, reinterpret_cast<unsigned char *>(&inputUsb), sizeof(inputUsb), reportCount == 0 ? timeoutMs : 0);
 
-    if (isBt)
-        res = hid_read_timeout(controller.handle, reinterpret_cast<unsigned char *>(&inputBt), sizeof(inputBt), 0);
-    else
-        res = hid_read_timeout(controller.handle, reinterpret_cast<unsigned char *>(&inputUsb), sizeof(inputUsb), 0);
+        if (res <= 0)
+            break;
 
-    dualsenseData::USBGetStateData inputData = isBt ? inputBt.Data.State.StateData : inputUsb.State;
+        const dualsenseData::USBGetStateData &report = isBt ? inputBt.Data.State.StateData : inputUsb.State;
 
-    if (controller.failedReadCount >= 15)
-    {
-        controller.valid = false;
+        if (!report.ButtonMute && lastMute)
+        {
+            controller.isMicMuted = !controller.isMicMuted;
+            muteToggled = true;
+        }
+
+        lastMute = report.ButtonMute;
+        uint32_t deltaUs = duaLibUtils::dualsenseTraits::sensorDeltaUs(lastTimestamp, report.SensorTimestamp);
+        duaLibUtils::updateMotion(controller, report, deltaUs);
+        duaLibUtils::updateGestures(controller, deltaUs);
+        lastTimestamp = report.SensorTimestamp;
+        inputData = report;
+        reportCount++;
     }
 
-    if (res == -1)
+    if (res == -1 && reportCount == 0)
     {
-        controller.failedReadCount++;
+        if (++controller.failedReadCount >= MAX_FAILED_READS)
+        {
+            if (controller.transition(duaLibUtils::connectionState::Live, duaLibUtils::connectionState::Lost))
+                duaLibUtils::pushConnectionEvent(controller, duaLibUtils::connectionState::Lost);
+        }
         return false;
     }
-    else if (res > 0)
+    else if (reportCount > 0)
     {
         controller.failedReadCount = 0;
+        controller.coalescedReports += reportCount - 1;
+        duaLibUtils::trackReport(controller, duaLibUtils::dualsenseTraits::sensorDeltaUs(controller.dualsenseCurInputState.SensorTimestamp, inputData.SensorTimestamp), reportCount);
+        duaLibUtils::applyCommands(controller);
 
-        if (!inputData.ButtonMute && controller.dualsenseCurInputState.ButtonMute)
+        if (muteToggled)
         {
             controller.dualsenseCurOutputState.AllowAudioMute = true;
-            controller.isMicMuted = !controller.isMicMuted;
             controller.dualsenseCurOutputState.MuteLightMode = controller.isMicMuted ? dualsenseData::MuteLight::On : dualsenseData::MuteLight::Off;
             controller.dualsenseCurOutputState.MicMute = controller.isMicMuted;
             controller.dualsenseCurOutputState.AllowMuteLight = true;
@@ -87,8 +118,11 @@ bool ReadDualsense(duaLibUtils::controller& controller)
 
         if (controller.wasDisconnected)
         {
+            // Replay everything the slot had, the pad came up with its defaults
             controller.dualsenseCurOutputState.MicMute = controller.isMicMuted;
+            controller.dualsenseCurOutputState.MuteLightMode = controller.isMicMuted ? dualsenseData::MuteLight::On : dualsenseData::MuteLight::Off;
             controller.dualsenseCurOutputState.AllowMuteLight = true;
+            controller.dualsenseCurOutputState.AllowAudioMute = true;
         }
 
         if (controller.dualsenseCurOutputState.OutputPathSelect != controller.dualsenseLastOutputState.OutputPathSelect ||
@@ -192,6 +226,8 @@ bool ReadDualsense(duaLibUtils::controller& controller)
         if (res > 0)
         {
             std::shared_lock guard(controller.lock);
+            if (controller.wasDisconnected)
+                duaLibUtils::trackRestore(controller);
             controller.wasDisconnected = false;
             // std::cout << "Controller idx " << controller.sceHandle << " path=" << controller.macAddress << " connType=" << (int)controller.connectionType << std::endl;
         }
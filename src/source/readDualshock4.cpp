@@ -2,35 +2,57 @@
 #include <duaLibUtils.hpp>
 #include <crc.h>
 #include <readDualshock4.hpp>
+#include <motion.hpp>
+#include <deviceTraits.hpp>
+#include <gesture.hpp>
 #include <algorithm>
 
-bool ReadDualshock4(duaLibUtils::controller &controller)
+bool ReadDualshock4(duaLibUtils::controller &controller, int timeoutMs)
 {
     bool isBt = controller.connectionType == HID_API_BUS_BLUETOOTH ? true : false;
 
     dualshock4Data::ReportIn01USB inputUsb = {};
     dualshock4Data::ReportIn01BT inputBt = {};
+    dualshock4Data::USBGetStateData inputData = {};
 
     int32_t res = -1;
+    uint32_t reportCount = 0;
+    uint16_t lastTimestamp = controller.dualshock4CurInputState.Timestamp;
 
-    if (isBt)
-        res = hid_read_timeout(controller.handle, reinterpret_cast<unsigned char *>(&inputBt), sizeof(inputBt), 0);
-    else
-        res = hid_read_timeout(controller.handle, reinterpret_cast<unsigned char *>(&inputUsb), sizeof(inputUsb), 0);
-
-    if (controller.failedReadCount >= 15)
+    // Drain everything that queued up since the last pass, only the newest report gets published
+    while (reportCount < MAX_DRAINED_REPORTS)
     {
-        controller.valid = false;
+        if (isBt)
+            res = duaLibUtils::readInputReport(controller, reinterpret_cast<unsigned char *>(&inputBt), sizeof(inputBt), reportCount == 0 ? timeoutMs : 0);
+        else
+            res = duaLibUtils::readInputReport(controller, reinterpret_cast<unsigned char *>(&inputUsb), sizeof(inputUsb), reportCount == 0 ? timeoutMs : 0);
+
+        if (res <= 0)
+            break;
+
+        inputData = isBt ? inputBt.State : inputUsb.State;
+        uint32_t deltaUs = duaLibUtils::dualshock4Traits::sensorDeltaUs(lastTimestamp, inputData.Timestamp);
+        duaLibUtils::updateMotion(controller, inputData, deltaUs);
+        duaLibUtils::updateGestures(controller, deltaUs);
+        lastTimestamp = inputData.Timestamp;
+        reportCount++;
     }
 
-    if (res == -1)
+    if (res == -1 && reportCount == 0)
     {
-        controller.failedReadCount++;
+        if (++controller.failedReadCount >= MAX_FAILED_READS)
+        {
+            if (controller.transition(duaLibUtils::connectionState::Live, duaLibUtils::connectionState::Lost))
+                duaLibUtils::pushConnectionEvent(controller, duaLibUtils::connectionState::Lost);
+        }
         return false;
     }
-    else if (res > 0)
+    else if (reportCount > 0)
     {
         controller.failedReadCount = 0;
+        controller.coalescedReports += reportCount - 1;
+        duaLibUtils::trackReport(controller, duaLibUtils::dualshock4Traits::sensorDeltaUs(controller.dualshock4CurInputState.Timestamp, inputData.Timestamp), reportCount);
+        duaLibUtils::applyCommands(controller);
 
         if (controller.dualshock4CurOutputState.LedRed != controller.dualshock4LastOutputState.LedRed ||
             controller.dualshock4CurOutputState.LedGreen != controller.dualshock4LastOutputState.LedGreen ||
@@ -105,11 +127,13 @@ bool ReadDualshock4(duaLibUtils::controller &controller)
             uint32_t crc = compute(report.CRC.Buff, sizeof(report) - 4);
             report.CRC.CRC = crc;
 
-            int res = hid_write(controller.handle, reinterpret_cast<unsigned char *>(&report), sizeof(report));
+            res = hid_write(controller.handle, reinterpret_cast<unsigned char *>(&report), sizeof(report));
         }
 
         if (res > 0)
         {
+            if (controller.wasDisconnected)
+                duaLibUtils::trackRestore(controller);
             controller.wasDisconnected = false;
             // std::cout << "Controller idx " << controller.sceHandle << " path=" << controller.macAddress << " connType=" << (int)controller.connectionType << std::endl;
         }
@@ -117,7 +141,7 @@ bool ReadDualshock4(duaLibUtils::controller &controller)
         {
             std::shared_lock guard(controller.lock);
             controller.dualshock4LastOutputState = controller.dualshock4CurOutputState;
-            controller.dualshock4CurInputState = isBt ? inputBt.State : inputUsb.State;
+            controller.dualshock4CurInputState = inputData;
         }
     }
 
@@ -0,0 +1,133 @@
+#include <deviceTraits.hpp>
+#include "testing.hpp"
+#include <cstdint>
+
+// Every button bit and D-pad value through buttonMask<Traits>, checked against a table and against the
+// if-chains the translator used before the traits
+template <typename Traits>
+struct buttonCase {
+	void (*press)(typename Traits::inputState& state);
+	uint32_t mask;
+};
+
+#define BUTTON(field, flag) { [](typename Traits::inputState& state) { state.field = 1; }, flag }
+
+template <typename Traits>
+static constexpr buttonCase<Traits> sharedButtons[] = {
+	BUTTON(ButtonCross, SCE_BM_CROSS),
+	BUTTON(ButtonCircle, SCE_BM_CIRCLE),
+	BUTTON(ButtonTriangle, SCE_BM_TRIANGLE),
+	BUTTON(ButtonSquare, SCE_BM_SQUARE),
+	BUTTON(ButtonL1, SCE_BM_L1),
+	BUTTON(ButtonL2, SCE_BM_L2),
+	BUTTON(ButtonR1, SCE_BM_R1),
+	BUTTON(ButtonR2, SCE_BM_R2),
+	BUTTON(ButtonL3, SCE_BM_L3),
+	BUTTON(ButtonR3, SCE_BM_R3),
+	BUTTON(ButtonOptions, SCE_BM_OPTIONS),
+	BUTTON(ButtonPad, SCE_BM_TOUCH),
+	BUTTON(ButtonHome, SCE_BM_PSBTN),
+};
+
+static constexpr buttonCase<duaLibUtils::dualsenseTraits> dualsenseShare = {
+	[](dualsenseData::USBGetStateData& state) { state.ButtonCreate = 1; }, SCE_BM_SHARE
+};
+static constexpr buttonCase<duaLibUtils::dualshock4Traits> dualshock4Share = {
+	[](dualshock4Data::USBGetStateData& state) { state.ButtonShare = 1; }, SCE_BM_SHARE
+};
+
+static constexpr uint32_t dpadMasks[16] = {
+	SCE_BM_N_DPAD,
+	SCE_BM_N_DPAD | SCE_BM_E_DPAD,
+	SCE_BM_E_DPAD,
+	SCE_BM_S_DPAD | SCE_BM_E_DPAD,
+	SCE_BM_S_DPAD,
+	SCE_BM_S_DPAD | SCE_BM_W_DPAD,
+	SCE_BM_W_DPAD,
+	SCE_BM_N_DPAD | SCE_BM_W_DPAD,
+	0, 0, 0, 0, 0, 0, 0, 0 // 8 is released, the rest never comes from a pad but mustn't set anything
+};
+
+// The translator before the traits, with share/home always on as in particular mode
+template <typename Traits>
+static uint32_t referenceMask(const typename Traits::inputState& state) {
+	uint32_t bitmaskButtons = 0;
+	if (state.ButtonCross) bitmaskButtons |= SCE_BM_CROSS;
+	if (state.ButtonCircle) bitmaskButtons |= SCE_BM_CIRCLE;
+	if (state.ButtonTriangle) bitmaskButtons |= SCE_BM_TRIANGLE;
+	if (state.ButtonSquare) bitmaskButtons |= SCE_BM_SQUARE;
+
+	if (state.ButtonL1) bitmaskButtons |= SCE_BM_L1;
+	if (state.ButtonL2) bitmaskButtons |= SCE_BM_L2;
+	if (state.ButtonR1) bitmaskButtons |= SCE_BM_R1;
+	if (state.ButtonR2) bitmaskButtons |= SCE_BM_R2;
+
+	if (state.ButtonL3) bitmaskButtons |= SCE_BM_L3;
+	if (state.ButtonR3) bitmaskButtons |= SCE_BM_R3;
+
+	if (state.DPad == Direction::NorthEast) bitmaskButtons |= SCE_BM_N_DPAD + SCE_BM_E_DPAD;
+	if (state.DPad == Direction::NorthWest) bitmaskButtons |= SCE_BM_N_DPAD + SCE_BM_W_DPAD;
+	if (state.DPad == Direction::SouthEast) bitmaskButtons |= SCE_BM_S_DPAD + SCE_BM_E_DPAD;
+	if (state.DPad == Direction::SouthWest) bitmaskButtons |= SCE_BM_S_DPAD + SCE_BM_W_DPAD;
+
+	if (state.DPad == Direction::North) bitmaskButtons |= SCE_BM_N_DPAD;
+	if (state.DPad == Direction::South) bitmaskButtons |= SCE_BM_S_DPAD;
+	if (state.DPad == Direction::East) bitmaskButtons |= SCE_BM_E_DPAD;
+	if (state.DPad == Direction::West) bitmaskButtons |= SCE_BM_W_DPAD;
+
+	if (state.ButtonOptions) bitmaskButtons |= SCE_BM_OPTIONS;
+	if (state.ButtonPad) bitmaskButtons |= SCE_BM_TOUCH;
+	if (Traits::share(state)) bitmaskButtons |= SCE_BM_SHARE;
+	if (state.ButtonHome) bitmaskButtons |= SCE_BM_PSBTN;
+
+	return bitmaskButtons;
+}
+
+template <typename Traits>
+static void maskTest(const buttonCase<Traits>& share) {
+	using inputState = typename Traits::inputState;
+	constexpr int sharedCount = sizeof(sharedButtons<Traits>) / sizeof(sharedButtons<Traits>[0]);
+	constexpr int buttonCount = sharedCount + 1;
+
+	auto button = [&](int i) -> const buttonCase<Traits>& { return i < sharedCount ? sharedButtons<Traits>[i] : share; };
+
+	// One at a time
+	for (int i = 0; i < buttonCount; i++) {
+		inputState state = {};
+		state.DPad = Direction::None;
+		button(i).press(state);
+		CHECK(duaLibUtils::buttonMask<Traits>(state) == button(i).mask);
+	}
+
+	for (int dpad = 0; dpad < 16; dpad++) {
+		inputState state = {};
+		state.DPad = static_cast<Direction>(dpad);
+		CHECK(duaLibUtils::buttonMask<Traits>(state) == dpadMasks[dpad]);
+	}
+
+	// Every combination
+	int mismatches = 0;
+	for (uint32_t pressed = 0; pressed < (1u << buttonCount); pressed++) {
+		for (int dpad = 0; dpad < 16; dpad++) {
+			inputState state = {};
+			state.DPad = static_cast<Direction>(dpad);
+			uint32_t expected = dpadMasks[dpad];
+
+			for (int i = 0; i < buttonCount; i++) {
+				if (!(pressed & (1u << i))) continue;
+				button(i).press(state);
+				expected |= button(i).mask;
+			}
+
+			uint32_t mask = duaLibUtils::buttonMask<Traits>(state);
+			mismatches += mask != expected || mask != referenceMask<Traits>(state);
+		}
+	}
+	CHECK(mismatches == 0);
+}
+
+int main() {
+	maskTest<duaLibUtils::dualsenseTraits>(dualsenseShare);
+	maskTest<duaLibUtils::dualshock4Traits>(dualshock4Share);
+	return testResult();
+}
@@ -0,0 +1,149 @@
+#include <gesture.hpp>
+#include <motion.hpp>
+#include "simulatedPad.hpp"
+#include "testing.hpp"
+#include <memory>
+#include <vector>
+
+// Reports go through updateMotion and updateGestures like the readers do them
+struct gestureRig {
+	std::unique_ptr<duaLibUtils::controller> controller = std::make_unique<duaLibUtils::controller>();
+	simulatedPad pad;
+	float time = 0.0f;
+
+	// threshold replaces the shake and tap defaults, 0 keeps them
+	gestureRig(float threshold = 0.0f) {
+		controller->gestureConfig.enabledGestures = SCE_PAD_GESTURE_SHAKE | SCE_PAD_GESTURE_TAP | SCE_PAD_GESTURE_FLICK | SCE_PAD_GESTURE_TWIST;
+		controller->gestureConfig.shakeThreshold = threshold;
+		controller->gestureConfig.tapThreshold = threshold;
+		controller->gestureConfigChanged = true;
+		report({ 0.0f,0.0f,0.0f }, 0);
+	}
+
+	void report(const s_SceFVector3& linear, uint32_t deltaUs) {
+		s_SceFVector3 a = pad.acceleration();
+		a = { a.x + linear.x, a.y + linear.y, a.z + linear.z };
+		duaLibUtils::updateMotion(*controller, a, pad.gyro(), 0.0f, deltaUs);
+		duaLibUtils::updateGestures(*controller, deltaUs);
+	}
+
+	// linear(t) is added to the accelerometer in the body frame
+	template <typename Linear>
+	void run(float seconds, Linear linear) {
+		constexpr uint32_t reportUs = 4000;
+		int reports = static_cast<int>(seconds * 1000000.0f / reportUs + 0.5f);
+		for (int i = 0; i < reports; i++) {
+			pad.step(reportUs / 1000000.0f);
+			time += reportUs / 1000000.0f;
+			report(linear(time), reportUs);
+		}
+	}
+
+	void run(float seconds) {
+		run(seconds, [](float) { return s_SceFVector3{ 0.0f,0.0f,0.0f }; });
+	}
+
+	std::vector<s_ScePadGestureEvent> events() {
+		std::vector<s_ScePadGestureEvent> events;
+		s_ScePadGestureEvent event = {};
+		while (controller->gestureEvents.pop(event)) events.push_back(event);
+		return events;
+	}
+};
+
+static int count(const std::vector<s_ScePadGestureEvent>& events, uint32_t type) {
+	int n = 0;
+	for (auto& event : events) n += event.type == type;
+	return n;
+}
+
+// Turning the pad, however fast, is not moving it. The thresholds are far below the defaults so that gravity
+// turned about the wrong axis would show up as shakes and taps here.
+static constexpr float sensitive = 0.3f; // g
+
+static std::vector<s_ScePadGestureEvent> noShakeOrTap(gestureRig& rig) {
+	auto events = rig.events();
+	CHECK(count(events, SCE_PAD_GESTURE_SHAKE) == 0);
+	CHECK(count(events, SCE_PAD_GESTURE_TAP) == 0);
+	return events;
+}
+
+static void rotationTest() {
+	gestureRig rest(sensitive);
+	rest.run(2.0f);
+	CHECK(rest.events().empty());
+
+	for (s_SceFVector3 rate : { s_SceFVector3{ 0.0f,12.0f,0.0f }, s_SceFVector3{ 0.0f,0.0f,12.0f }, s_SceFVector3{ 12.0f,0.0f,0.0f } }) {
+		gestureRig rig(sensitive);
+		rig.pad.rate = rate;
+		rig.run(0.1f);
+		rig.pad.rate = { 0.0f,0.0f,0.0f };
+		rig.run(1.0f);
+
+		CHECK(count(noShakeOrTap(rig), SCE_PAD_GESTURE_FLICK) == 1);
+	}
+
+	// Wiggling the pad about yaw while it lies flat, 35 degrees either way
+	gestureRig wiggle(sensitive);
+	wiggle.pad.rate = { 0.0f,12.0f,0.0f };
+	wiggle.run(0.05f);
+	for (int i = 0; i < 6; i++) {
+		wiggle.pad.rate = { 0.0f, i & 1 ? 12.0f : -12.0f, 0.0f };
+		wiggle.run(0.1f);
+	}
+	wiggle.pad.rate = { 0.0f,-12.0f,0.0f };
+	wiggle.run(0.05f);
+	wiggle.pad.rate = { 0.0f,0.0f,0.0f };
+	wiggle.run(1.0f);
+	noShakeOrTap(wiggle);
+
+	// A jolt there and back about yaw, over as quickly as a tap
+	gestureRig jolt(sensitive);
+	jolt.pad.rate = { 0.0f,30.0f,0.0f };
+	jolt.run(0.016f);
+	jolt.pad.rate = { 0.0f,-30.0f,0.0f };
+	jolt.run(0.016f);
+	jolt.pad.rate = { 0.0f,0.0f,0.0f };
+	jolt.run(1.0f);
+	noShakeOrTap(jolt);
+}
+
+static void gestureTest() {
+	gestureRig shake;
+	shake.run(0.4f, [](float t) { return s_SceFVector3{ 3.0f * std::sin(2.0f * 3.14159265f * 10.0f * t), 0.0f, 0.0f }; });
+	shake.run(1.0f);
+	auto events = shake.events();
+	CHECK(count(events, SCE_PAD_GESTURE_SHAKE) == 1);
+	CHECK(count(events, SCE_PAD_GESTURE_TAP) == 0);
+
+	gestureRig tap;
+	tap.run(0.5f);
+	tap.run(0.008f, [](float) { return s_SceFVector3{ 0.0f,0.0f,-4.0f }; });
+	tap.run(1.0f);
+	events = tap.events();
+	CHECK(events.size() == 1 && events[0].type == SCE_PAD_GESTURE_TAP && events[0].axis == 2 && events[0].direction == -1);
+
+	// Yaw is angularVelocity.z
+	gestureRig flick;
+	flick.pad.rate = { 0.0f,15.0f,0.0f };
+	flick.run(0.04f);
+	flick.pad.rate = { 0.0f,0.0f,0.0f };
+	flick.run(0.5f);
+	events = flick.events();
+	CHECK(events.size() == 1 && events[0].type == SCE_PAD_GESTURE_FLICK && events[0].axis == 2 && events[0].direction == 1);
+
+	// Roll is angularVelocity.y
+	gestureRig twist;
+	twist.pad.rate = { 0.0f,0.0f,-2.0f };
+	twist.run(0.8f);
+	twist.pad.rate = { 0.0f,0.0f,0.0f };
+	twist.run(0.5f);
+	events = twist.events();
+	CHECK(events.size() == 1 && events[0].type == SCE_PAD_GESTURE_TWIST && events[0].axis == 1 && events[0].direction == -1);
+}
+
+int main() {
+	rotationTest();
+	gestureTest();
+	return testResult();
+}
@@ -0,0 +1,126 @@
+#include <hotplug.hpp>
+#include "testing.hpp"
+#include <algorithm>
+#include <string>
+
+// Captured from `udevadm monitor --kernel --property` with a DualSense on USB, kernel side (group 1) messages
+static const char dualsenseAdd[] =
+	"add@/devices/pci0000:00/0000:00:14.0/usb1/1-2/1-2:1.3/0003:054C:0CE6.0005/hidraw/hidraw3\0"
+	"ACTION=add\0"
+	"DEVPATH=/devices/pci0000:00/0000:00:14.0/usb1/1-2/1-2:1.3/0003:054C:0CE6.0005/hidraw/hidraw3\0"
+	"SUBSYSTEM=hidraw\0"
+	"MAJOR=241\0"
+	"MINOR=3\0"
+	"DEVNAME=hidraw3\0"
+	"SEQNUM=4521";
+
+static const char dualsenseRemove[] =
+	"remove@/devices/pci0000:00/0000:00:14.0/usb1/1-2/1-2:1.3/0003:054C:0CE6.0005/hidraw/hidraw3\0"
+	"ACTION=remove\0"
+	"DEVPATH=/devices/pci0000:00/0000:00:14.0/usb1/1-2/1-2:1.3/0003:054C:0CE6.0005/hidraw/hidraw3\0"
+	"SUBSYSTEM=hidraw\0"
+	"MAJOR=241\0"
+	"MINOR=3\0"
+	"DEVNAME=hidraw3\0"
+	"SEQNUM=4533";
+
+static const char inputAdd[] =
+	"add@/devices/pci0000:00/0000:00:14.0/usb1/1-2/1-2:1.3/0003:054C:0CE6.0005/input/input25\0"
+	"ACTION=add\0"
+	"DEVPATH=/devices/pci0000:00/0000:00:14.0/usb1/1-2/1-2:1.3/0003:054C:0CE6.0005/input/input25\0"
+	"SUBSYSTEM=input\0"
+	"PRODUCT=3/54c/ce6/8111\0"
+	"SEQNUM=4519";
+
+static const char hidrawBind[] =
+	"bind@/devices/pci0000:00/0000:00:14.0/usb1/1-2/1-2:1.3/0003:054C:0CE6.0005\0"
+	"ACTION=bind\0"
+	"DEVPATH=/devices/pci0000:00/0000:00:14.0/usb1/1-2/1-2:1.3/0003:054C:0CE6.0005\0"
+	"SUBSYSTEM=hid\0"
+	"SEQNUM=4522";
+
+static bool s_bound = false;
+static bool isBound(const std::string&) { return s_bound; }
+
+static void parseTest() {
+	duaLibUtils::hotplugEvent event = {};
+
+	CHECK(duaLibUtils::parseUevent(dualsenseAdd, sizeof(dualsenseAdd), event));
+	CHECK(event.action == duaLibUtils::hotplugAction::Add);
+	CHECK(event.devnode == "/dev/hidraw3");
+
+	event = {};
+	CHECK(duaLibUtils::parseUevent(dualsenseRemove, sizeof(dualsenseRemove), event));
+	CHECK(event.action == duaLibUtils::hotplugAction::Remove);
+	CHECK(event.devnode == "/dev/hidraw3");
+
+	event = {};
+	CHECK(!duaLibUtils::parseUevent(inputAdd, sizeof(inputAdd), event));
+	CHECK(!duaLibUtils::parseUevent(hidrawBind, sizeof(hidrawBind), event));
+	CHECK(event.action == duaLibUtils::hotplugAction::None);
+
+	// Cut off before DEVNAME
+	CHECK(!duaLibUtils::parseUevent(dualsenseAdd, 160, event));
+}
+
+// Same sequence as watchFunc: wait, queue, scan, schedule
+static void watchTest() {
+	duaLibUtils::hotplugMonitor monitor = {};
+	duaLibUtils::hotplugQueue queue = {};
+	std::vector<duaLibUtils::hotplugEvent> events;
+	std::vector<std::string> removed;
+	const int64_t fallbackUs = HOTPLUG_FALLBACK_SCAN_MS * 1000LL;
+	int64_t now = 10000000;
+
+	queue.nextScanUs = now + fallbackUs;
+	CHECK(!duaLibUtils::waitHotplugEvents(monitor, 0, events));
+
+	duaLibUtils::injectUevent(monitor, inputAdd, sizeof(inputAdd));
+	duaLibUtils::injectUevent(monitor, dualsenseAdd, sizeof(dualsenseAdd));
+	CHECK(duaLibUtils::waitHotplugEvents(monitor, 0, events));
+	CHECK(events.size() == 1);
+
+	duaLibUtils::queueHotplugEvents(queue, events, now, removed);
+	CHECK(removed.empty());
+	CHECK(queue.pending.size() == 1 && queue.pending[0] == "/dev/hidraw3");
+	CHECK(queue.nextScanUs <= now); // scans right away
+
+	// udev hasn't fixed the permissions yet, the node keeps getting retried
+	s_bound = false;
+	duaLibUtils::scheduleHotplugScan(queue, now, fallbackUs, isBound);
+	CHECK(queue.nextScanUs == now + HOTPLUG_RETRY_MS * 1000LL);
+	CHECK(queue.pending.size() == 1);
+
+	// ...until the retry window runs out
+	duaLibUtils::scheduleHotplugScan(queue, now + HOTPLUG_RETRY_WINDOW_MS * 1000LL, fallbackUs, isBound);
+	CHECK(queue.nextScanUs == now + HOTPLUG_RETRY_WINDOW_MS * 1000LL + fallbackUs);
+
+	// Bound by the scan, back to the slow fallback
+	duaLibUtils::queueHotplugEvents(queue, events, now, removed);
+	s_bound = true;
+	duaLibUtils::scheduleHotplugScan(queue, now, fallbackUs, isBound);
+	CHECK(queue.pending.empty());
+	CHECK(queue.nextScanUs == now + fallbackUs);
+
+	// Unplugged, the slot is dropped without waiting for a scan
+	duaLibUtils::injectUevent(monitor, dualsenseRemove, sizeof(dualsenseRemove));
+	CHECK(duaLibUtils::waitHotplugEvents(monitor, 0, events));
+	duaLibUtils::queueHotplugEvents(queue, events, now, removed);
+	CHECK(removed.size() == 1 && removed[0] == "/dev/hidraw3");
+	CHECK(queue.nextScanUs == now + fallbackUs);
+
+	// Plugged in and out again before the watcher woke up
+	duaLibUtils::injectUevent(monitor, dualsenseAdd, sizeof(dualsenseAdd));
+	duaLibUtils::injectUevent(monitor, dualsenseRemove, sizeof(dualsenseRemove));
+	CHECK(duaLibUtils::waitHotplugEvents(monitor, 0, events));
+	CHECK(events.size() == 2);
+	duaLibUtils::queueHotplugEvents(queue, events, now, removed);
+	CHECK(queue.pending.empty());
+	CHECK(removed.size() == 1);
+}
+
+int main() {
+	parseTest();
+	watchTest();
+	return testResult();
+}
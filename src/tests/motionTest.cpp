@@ -0,0 +1,285 @@
+#include <motion.hpp>
+#include <deviceTraits.hpp>
+#include "simulatedPad.hpp"
+#include "testing.hpp"
+#include <memory>
+#include <random>
+
+static constexpr uint32_t reportUs = 4000;
+static constexpr float toDegrees = 57.2957795f;
+
+// Same swap as translateState
+static s_SceFQuaternion published(const duaLibUtils::controller& controller) {
+	const auto& q = controller.orientation;
+	return { q.x, q.z, q.y, q.w };
+}
+
+static float angleBetween(const s_SceFQuaternion& a, const s_SceFQuaternion& b) {
+	float dot = std::fabs(a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w);
+	return 2.0f * std::acos(std::min(1.0f, dot)) * toDegrees;
+}
+
+static void run(duaLibUtils::controller& controller, simulatedPad& pad, float seconds, const s_SceFVector3& bias = { 0.0f,0.0f,0.0f }) {
+	int reports = static_cast<int>(seconds * 1000000.0f / reportUs);
+	for (int i = 0; i < reports; i++) {
+		pad.step(reportUs / 1000000.0f);
+		duaLibUtils::updateMotion(controller, pad.acceleration(), pad.gyro(bias), 0.0f, reportUs);
+	}
+}
+
+static std::unique_ptr<duaLibUtils::controller> makeController(bool tiltCorrection) {
+	auto controller = std::make_unique<duaLibUtils::controller>();
+	controller->tiltCorrection = tiltCorrection;
+	duaLibUtils::updateMotion(*controller, { 0.0f,1.0f,0.0f }, { 0.0f,0.0f,0.0f }, 0.0f, 0); // first report isn't integrated
+	return controller;
+}
+
+// Turn by `degrees` about one body axis over half a second, then hold it for five
+static void holdTest(const s_SceFVector3& axis, float degrees) {
+	auto controller = makeController(true);
+	simulatedPad pad;
+	float rate = degrees / toDegrees / 0.5f;
+
+	pad.rate = { axis.x * rate, axis.y * rate, axis.z * rate };
+	run(*controller, pad, 0.5f);
+	CHECK_NEAR(angleBetween(published(*controller), pad.q), 0.0, 1.0);
+
+	pad.rate = { 0.0f,0.0f,0.0f };
+	run(*controller, pad, 5.0f);
+	CHECK_NEAR(angleBetween(published(*controller), pad.q), 0.0, 1.0);
+	CHECK_NEAR(angleBetween(published(*controller), { 0.0f,0.0f,0.0f,1.0f }), std::fabs(degrees), 1.0);
+}
+
+// A biased gyro on a pad lying still, tilt correction has to keep pitch and roll. Yaw isn't observable.
+static void driftTest(const s_SceFVector3& bias, bool observable) {
+	auto controller = makeController(true);
+	simulatedPad pad;
+
+	run(*controller, pad, 20.0f, bias);
+	float error = angleBetween(published(*controller), pad.q);
+	if (observable) CHECK(error < 2.0f);
+	else CHECK(error > 10.0f);
+}
+
+// The same pad with the rest estimator on: it has to find the bias, and once it has, yaw, which tilt correction can't see,
+// has to stop drifting too
+static void restBiasTest(const s_SceFVector3& bias) {
+	auto controller = makeController(true);
+	controller->gyroBiasEstimation = true;
+	simulatedPad pad;
+
+	run(*controller, pad, 5.0f, bias);
+	s_SceFVector3 expected = pad.gyro(bias); // report order, the pad isn't turning
+	CHECK_NEAR(controller->gyroBias.bias.x, expected.x, 0.0005);
+	CHECK_NEAR(controller->gyroBias.bias.y, expected.y, 0.0005);
+	CHECK_NEAR(controller->gyroBias.bias.z, expected.z, 0.0005);
+
+	s_SceFQuaternion settled = published(*controller);
+	run(*controller, pad, 20.0f, bias);
+	CHECK(angleBetween(published(*controller), settled) < 0.1f);
+}
+
+// Gyro bias drifting linearly with the IMU temperature, pad frame like simulatedPad::rate
+static s_SceFVector3 thermalBias(float temperature) {
+	float t = temperature - 20.0f;
+	return { 0.01f + 0.002f * t, -0.005f - 0.001f * t, 0.003f * t };
+}
+
+static bool between(float value, float a, float b) {
+	return value >= std::min(a, b) && value <= std::max(a, b);
+}
+
+// The pad warms up across two rest periods with a turn in between. The fit over both has to land on the bias at
+// any temperature in between, and must not follow the line far past the temperatures it rested at.
+static void temperatureTest() {
+	auto controller = makeController(false);
+	controller->gyroBiasEstimation = true;
+	simulatedPad pad;
+	float temperature = 20.0f;
+
+	auto ramp = [&](float seconds, float target, const s_SceFVector3& rate) {
+		float start = temperature;
+		int reports = static_cast<int>(seconds * 1000000.0f / reportUs);
+		pad.rate = rate;
+		for (int i = 0; i < reports; i++) {
+			temperature = start + (target - start) * (i + 1) / reports;
+			pad.step(reportUs / 1000000.0f);
+			duaLibUtils::updateMotion(*controller, pad.acceleration(), pad.gyro(thermalBias(temperature)), temperature, reportUs);
+		}
+	};
+	auto expected = [](float temperature) {
+		s_SceFVector3 b = thermalBias(temperature);
+		return s_SceFVector3{ b.x, b.z, b.y }; // report order
+	};
+
+	ramp(10.0f, 22.0f, { 0.0f,0.0f,0.0f }); // first rest, too little spread for a slope yet
+	ramp(5.0f, 28.0f, { 0.0f,1.0f,0.0f });  // warming up while turning, nothing learned
+	ramp(10.0f, 30.0f, { 0.0f,0.0f,0.0f }); // second rest
+
+	const auto& bias = controller->gyroBias.bias;
+	CHECK_NEAR(bias.x, expected(30.0f).x, 0.0005);
+	CHECK_NEAR(bias.y, expected(30.0f).y, 0.0005);
+	CHECK_NEAR(bias.z, expected(30.0f).z, 0.0005);
+
+	// Moving, between the two rests
+	ramp(0.1f, 25.0f, { 0.0f,1.0f,0.0f });
+	CHECK_NEAR(bias.x, expected(25.0f).x, 0.0005);
+	CHECK_NEAR(bias.y, expected(25.0f).y, 0.0005);
+	CHECK_NEAR(bias.z, expected(25.0f).z, 0.0005);
+
+	// A reading far outside stops about two standard deviations (~4 units) past the rests' mean of ~25
+	ramp(0.1f, 80.0f, { 0.0f,1.0f,0.0f });
+	CHECK(between(bias.x, expected(30.0f).x, expected(36.0f).x));
+	CHECK(between(bias.y, expected(30.0f).y, expected(36.0f).y));
+	CHECK(between(bias.z, expected(30.0f).z, expected(36.0f).z));
+}
+
+static void tiltTest() {
+	holdTest({ 0.0f,1.0f,0.0f }, 90.0f);  // yaw, flat the whole time
+	holdTest({ 0.0f,1.0f,0.0f }, -90.0f);
+	holdTest({ 0.0f,0.0f,1.0f }, 30.0f);  // roll
+	holdTest({ 0.0f,0.0f,1.0f }, -45.0f);
+	holdTest({ 1.0f,0.0f,0.0f }, 30.0f);  // pitch
+	holdTest({ 1.0f,0.0f,0.0f }, -45.0f);
+
+	driftTest({ 0.0f,0.0f,0.02f }, true);  // roll
+	driftTest({ 0.02f,0.0f,0.0f }, true);  // pitch
+	driftTest({ 0.0f,0.02f,0.0f }, false); // yaw
+	restBiasTest({ 0.0f,0.02f,0.0f });
+	restBiasTest({ 0.01f,-0.03f,0.02f });
+
+	// Without correction the roll drift stays
+	auto controller = makeController(false);
+	simulatedPad pad;
+	run(*controller, pad, 20.0f, { 0.0f,0.0f,0.02f });
+	CHECK(angleBetween(published(*controller), pad.q) > 10.0f);
+}
+
+// Reports at a jittered rate, timed only by the device clock the way the readers see it. Whatever the jitter and
+// however often the counter wraps, the integrated angle has to match the time that really passed.
+template <typename Traits, typename Clock>
+static void clockTest(double tickUs, double intervalUs, double jitterUs, Clock start) {
+	auto controller = makeController(false);
+	simulatedPad pad;
+	pad.rate = { 0.0f,2.0f,0.0f }; // yaw, flat
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<double> jitter(-jitterUs, jitterUs);
+
+	double timeUs = 0.0;
+	Clock last = start;
+	int reports = static_cast<int>(5000000.0 / intervalUs);
+	for (int i = 0; i < reports; i++) {
+		double stepUs = intervalUs + jitter(random);
+		timeUs += stepUs;
+		Clock now = static_cast<Clock>(start + static_cast<uint64_t>(timeUs / tickUs));
+
+		pad.step(static_cast<float>(stepUs / 1000000.0));
+		duaLibUtils::updateMotion(*controller, pad.acceleration(), pad.gyro(), 0.0f, Traits::sensorDeltaUs(last, now));
+		last = now;
+	}
+
+	// Against the exact turn, the float simulation drifts more than the integrator does
+	double turned = 2.0 * timeUs / 1000000.0;
+	s_SceFQuaternion exact = { 0.0f,static_cast<float>(std::sin(turned / 2.0)),0.0f,static_cast<float>(std::cos(turned / 2.0)) };
+	CHECK_NEAR(controller->rotation[2], turned, turned * 0.00002); // 100 us over the whole run
+	CHECK(angleBetween(published(*controller), exact) < 0.05f);
+}
+
+static void deviceClockTest() {
+	// DualSense USB, 1/3 us ticks, starting just short of the 32 bit wrap
+	clockTest<duaLibUtils::dualsenseTraits, uint32_t>(1.0 / 3.0, 1000.0, 300.0, 0xFFFF0000u);
+	// DualSense BT
+	clockTest<duaLibUtils::dualsenseTraits, uint32_t>(1.0 / 3.0, 1333.0, 600.0, 0u);
+	// DS4 BT, 16/3 us ticks on a 16 bit counter that wraps ~14 times here
+	clockTest<duaLibUtils::dualshock4Traits, uint16_t>(16.0 / 3.0, 4000.0, 1500.0, 0xFF00);
+}
+
+// Turning the pad without moving it mustn't show up as linear acceleration, worst case over every report
+static float worstLinearAcceleration(const s_SceFVector3& rate, float seconds) {
+	auto controller = makeController(false);
+	simulatedPad pad;
+	pad.rate = rate;
+	float worst = 0.0f;
+
+	int reports = static_cast<int>(seconds * 1000000.0f / reportUs);
+	for (int i = 0; i < reports; i++) {
+		pad.step(reportUs / 1000000.0f);
+		duaLibUtils::updateMotion(*controller, pad.acceleration(), pad.gyro(), 0.0f, reportUs);
+
+		const auto& a = controller->acceleration;
+		const auto& g = controller->gravity;
+		s_SceFVector3 linear = { a.x - g.x, a.y - g.y, a.z - g.z };
+		worst = std::max(worst, std::sqrt(linear.x * linear.x + linear.y * linear.y + linear.z * linear.z));
+	}
+	return worst;
+}
+
+static void gravityTest() {
+	CHECK(worstLinearAcceleration({ 0.0f,3.0f,0.0f }, 0.3f) < 0.02f);  // yaw, flat
+	CHECK(worstLinearAcceleration({ 0.0f,0.0f,3.0f }, 0.3f) < 0.02f);  // roll
+	CHECK(worstLinearAcceleration({ 3.0f,0.0f,0.0f }, 0.3f) < 0.02f);  // pitch
+	CHECK(worstLinearAcceleration({ 1.0f,2.0f,-1.5f }, 2.0f) < 0.02f); // all at once, through several turns
+}
+
+// Feeds a stick through trackStickVelocity the way publishState does and predicts the furthest allowed lead
+struct stickFeed {
+	duaLibUtils::publishedState state = {};
+
+	uint8_t next(uint8_t value, int64_t elapsedUs) {
+		s_ScePadData last = state.data;
+		state.data.LeftStick.X = value;
+		duaLibUtils::trackStickVelocity(state, last, elapsedUs);
+
+		duaLibUtils::publishedState predicted = state;
+		duaLibUtils::predictState(predicted, MAX_PREDICTION_US / 1000000.0f, false);
+		return predicted.data.LeftStick.X;
+	}
+};
+
+static void stickPredictionTest() {
+	std::mt19937 random(1234);
+	std::uniform_int_distribution<int> lsb(-1, 1);
+
+	// A resting stick with 1 LSB of noise, at DS4 BT, DualSense BT and DualSense USB report rates
+	for (int64_t intervalUs : { 4000, 1333, 1000 }) {
+		stickFeed feed;
+		feed.state.data.LeftStick.X = 128;
+		int worst = 0;
+
+		for (int i = 0; i < 10000; i++) {
+			int predicted = feed.next(static_cast<uint8_t>(128 + lsb(random)), intervalUs);
+			worst = std::max(worst, std::abs(predicted - 128));
+		}
+		CHECK(worst <= 2);
+	}
+
+	// Alternating every report is the worst case for the low pass
+	stickFeed feed;
+	feed.state.data.LeftStick.X = 128;
+	int worst = 0;
+	for (int i = 0; i < 1000; i++) {
+		int predicted = feed.next(static_cast<uint8_t>(128 + (i & 1)), 1000);
+		worst = std::max(worst, std::abs(predicted - 128));
+	}
+	CHECK(worst <= 2);
+
+	// A stick swept at 1000 units/s is still led by about the full 50ms
+	feed = {};
+	feed.state.data.LeftStick.X = 20;
+	float value = 20.0f;
+	int lead = 0;
+	for (int i = 0; i < 150; i++) {
+		value += 1000.0f * 0.001f;
+		lead = feed.next(static_cast<uint8_t>(value), 1000) - static_cast<int>(value);
+	}
+	CHECK(lead >= 35 && lead <= 55);
+}
+
+int main() {
+	tiltTest();
+	stickPredictionTest();
+	gravityTest();
+	deviceClockTest();
+	temperatureTest();
+	return testResult();
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <duaLib.h>
+#include <cmath>
+
+// A pad simulated in its own right handed sensor frame (x right, y up, z towards the player, the accelerometer's
+// axes), fed through updateMotion the way the reports lay it out: the yaw rate lands in AngularVelocityZ.
+struct simulatedPad {
+	s_SceFQuaternion q = { 0.0f,0.0f,0.0f,1.0f }; // body to world
+	s_SceFVector3 rate = { 0.0f,0.0f,0.0f };      // body frame, rad/s
+
+	void step(float deltaTime) {
+		s_SceFVector3 r = { rate.x * deltaTime, rate.y * deltaTime, rate.z * deltaTime };
+		float angle = std::sqrt(r.x * r.x + r.y * r.y + r.z * r.z);
+		if (angle == 0.0f) return;
+
+		float s = std::sin(angle * 0.5f) / angle;
+		s_SceFQuaternion d = { r.x * s, r.y * s, r.z * s, std::cos(angle * 0.5f) };
+		q = {
+			q.w * d.x + q.x * d.w + q.y * d.z - q.z * d.y,
+			q.w * d.y + q.y * d.w + q.z * d.x - q.x * d.z,
+			q.w * d.z + q.z * d.w + q.x * d.y - q.y * d.x,
+			q.w * d.w - q.x * d.x - q.y * d.y - q.z * d.z
+		};
+	}
+
+	// World gravity reaction (0, 1, 0) seen from the body
+	s_SceFVector3 acceleration() const {
+		return { 2.0f * (q.x * q.y + q.w * q.z), 1.0f - 2.0f * (q.x * q.x + q.z * q.z), 2.0f * (q.y * q.z - q.w * q.x) };
+	}
+
+	s_SceFVector3 gyro(const s_SceFVector3& bias = { 0.0f,0.0f,0.0f }) const {
+		return { rate.x + bias.x, rate.z + bias.z, rate.y + bias.y };
+	}
+};
@@ -0,0 +1,104 @@
+#include <duaLibUtils.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <thread>
+
+// Not a test, prints what scePadReadState's loadState costs across four slots while an I/O thread is busy with
+// them, once with the slot fields packed the way they were before the hot/cold split and once split. Only the slot
+// grouping differs, both use the same snapshot. Run it on a machine with at least two cores, on one the threads
+// never touch the lines at the same time.
+static constexpr int slotCount = MAX_CONTROLLER_COUNT;
+static constexpr int rounds = 2000000;
+
+// Header and reader fields side by side, slots back to back
+struct packedSlot {
+	std::atomic<duaLibUtils::connectionState> connection = duaLibUtils::connectionState::Live;
+	uint32_t sceHandle = 0;
+	uint32_t failedReadCount = 0;
+	std::atomic<bool> motionSensorState = true;
+	duaLibUtils::reportTiming timing = {};
+	dualsenseData::USBGetStateData dualsenseCurInputState = {};
+	duaLibUtils::snapshot<duaLibUtils::publishedState> state = {};
+};
+
+// Each group on its own lines like duaLibUtils::controller
+struct splitSlot {
+	alignas(CACHE_LINE_SIZE) std::atomic<duaLibUtils::connectionState> connection = duaLibUtils::connectionState::Live;
+	uint32_t sceHandle = 0;
+	std::atomic<bool> motionSensorState = true;
+	duaLibUtils::snapshot<duaLibUtils::publishedState> state = {};
+
+	alignas(CACHE_LINE_SIZE) uint32_t failedReadCount = 0;
+	duaLibUtils::reportTiming timing = {};
+	alignas(CACHE_LINE_SIZE) dualsenseData::USBGetStateData dualsenseCurInputState = {};
+};
+
+// The game side of loadState
+template <typename Slot>
+static bool load(const Slot& slot, uint32_t handle, duaLibUtils::publishedState& state, bool& motion) {
+	if (slot.sceHandle != handle) return false;
+	if (slot.connection.load(std::memory_order_acquire) != duaLibUtils::connectionState::Live) return false;
+
+	slot.state.load(state);
+	motion = slot.motionSensorState.load(std::memory_order_relaxed);
+	return true;
+}
+
+template <typename Slot>
+static double measure(const char* name) {
+	auto slots = std::make_unique<Slot[]>(slotCount);
+	for (int i = 0; i < slotCount; i++) {
+		slots[i].sceHandle = i + 1;
+		slots[i].state.store({});
+	}
+
+	// Reader passes touch their block every time, a report gets published every few passes
+	std::atomic<bool> running = true;
+	std::thread io([&]() {
+		uint64_t pass = 0;
+		duaLibUtils::publishedState published = {};
+		while (running.load(std::memory_order_relaxed)) {
+			for (int i = 0; i < slotCount; i++) {
+				auto& slot = slots[i];
+				slot.failedReadCount = 0;
+				slot.timing.reports++;
+				slot.timing.lastArrivalUs = static_cast<int64_t>(pass);
+				slot.dualsenseCurInputState.SensorTimestamp = static_cast<uint32_t>(pass);
+
+				if (pass % 8 == 0) {
+					published.sampleUs = static_cast<int64_t>(pass);
+					slot.state.store(published);
+				}
+			}
+			pass++;
+		}
+	});
+
+	duaLibUtils::publishedState state = {};
+	bool motion = false;
+	uint64_t loaded = 0;
+
+	auto start = std::chrono::steady_clock::now();
+	for (int round = 0; round < rounds; round++) {
+		for (int i = 0; i < slotCount; i++) {
+			loaded += load(slots[i], i + 1, state, motion);
+		}
+	}
+	auto elapsed = std::chrono::steady_clock::now() - start;
+
+	running = false;
+	io.join();
+
+	double ns = std::chrono::duration<double, std::nano>(elapsed).count() / (static_cast<double>(rounds) * slotCount);
+	std::printf("%-7s %4zu bytes/slot %8.1f ns/loadState (%llu loaded)\n", name, sizeof(Slot), ns, static_cast<unsigned long long>(loaded));
+	return ns;
+}
+
+int main() {
+	double packed = measure<packedSlot>("packed");
+	double split = measure<splitSlot>("split");
+	std::printf("split/packed %.2f\n", split / packed);
+	return 0;
+}
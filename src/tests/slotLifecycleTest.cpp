@@ -0,0 +1,109 @@
+#include <duaLibUtils.hpp>
+#include "testing.hpp"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+// Closing while a pass is inside has to wait for it, a closed slot lets no pass in
+static void handshakeTest() {
+	auto controller = std::make_unique<duaLibUtils::controller>();
+	controller->connection = duaLibUtils::connectionState::Live;
+
+	CHECK(controller->enterIo());
+	CHECK(controller->transition(duaLibUtils::connectionState::Live, duaLibUtils::connectionState::Lost));
+
+	std::atomic<bool> idle = false;
+	std::thread closer([&]() {
+		controller->waitIoIdle();
+		idle = true;
+	});
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	CHECK(!idle.load());
+	controller->leaveIo();
+	closer.join();
+	CHECK(idle.load());
+
+	CHECK(!controller->enterIo());
+	CHECK(!controller->ioBusy.load());
+}
+
+// A reader keeps running passes while the slot is closed and reopened under it. Once waitIoIdle returns no pass
+// may be inside, and none may start until the slot is Live again.
+static void stressTest() {
+	auto controller = std::make_unique<duaLibUtils::controller>();
+	controller->connection = duaLibUtils::connectionState::Live;
+
+	std::atomic<bool> running = true;
+	std::atomic<int> inside = 0;
+	std::atomic<uint64_t> passes = 0;
+	std::atomic<int> work = 0;
+	auto spin = [&](int count) { for (int i = 0; i < count; i++) work.fetch_add(1, std::memory_order_relaxed); };
+
+	std::thread reader([&]() {
+		while (running.load(std::memory_order_relaxed)) {
+			if (!controller->enterIo()) continue;
+
+			inside.fetch_add(1, std::memory_order_relaxed);
+			spin(50);
+			inside.fetch_sub(1, std::memory_order_relaxed);
+			passes.fetch_add(1, std::memory_order_relaxed);
+
+			controller->leaveIo();
+		}
+	});
+
+	int violations = 0;
+	for (int round = 0; round < 20000; round++) {
+		CHECK(controller->transition(duaLibUtils::connectionState::Live, duaLibUtils::connectionState::Closed));
+		controller->waitIoIdle();
+
+		uint64_t before = passes.load(std::memory_order_relaxed);
+		violations += inside.load(std::memory_order_relaxed) != 0;
+		spin(200);
+		violations += passes.load(std::memory_order_relaxed) != before || inside.load(std::memory_order_relaxed) != 0;
+
+		controller->connection.store(duaLibUtils::connectionState::Live, std::memory_order_seq_cst);
+		if (round % 64 == 0) std::this_thread::yield(); // let the reader in on a single core
+	}
+
+	running = false;
+	reader.join();
+
+	CHECK(violations == 0);
+	CHECK(passes.load() > 0);
+	CHECK(!controller->ioBusy.load());
+}
+
+// A pad that drops out and comes back is reported in order, the game's own close isn't
+static void eventTest() {
+	auto controller = std::make_unique<duaLibUtils::controller>();
+
+	duaLibUtils::pushConnectionEvent(*controller, duaLibUtils::connectionState::Opening);
+	duaLibUtils::pushConnectionEvent(*controller, duaLibUtils::connectionState::Live);
+	duaLibUtils::pushConnectionEvent(*controller, duaLibUtils::connectionState::Lost);
+	duaLibUtils::pushConnectionEvent(*controller, duaLibUtils::connectionState::Reconnecting);
+	duaLibUtils::pushConnectionEvent(*controller, duaLibUtils::connectionState::Live);
+	duaLibUtils::pushConnectionEvent(*controller, duaLibUtils::connectionState::Closed);
+
+	const uint32_t expected[] = { SCE_PAD_CONNECTION_OPENING, SCE_PAD_CONNECTION_LIVE, SCE_PAD_CONNECTION_LOST,
+		SCE_PAD_CONNECTION_RECONNECTING, SCE_PAD_CONNECTION_LIVE };
+	s_ScePadConnectionEvent event = {};
+	uint64_t last = 0;
+
+	for (uint32_t state : expected) {
+		CHECK(controller->connectionEvents.pop(event));
+		CHECK(event.state == state);
+		CHECK(event.timestamp >= last);
+		last = event.timestamp;
+	}
+	CHECK(!controller->connectionEvents.pop(event));
+}
+
+int main() {
+	handshakeTest();
+	stressTest();
+	eventTest();
+	return testResult();
+}
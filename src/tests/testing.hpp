@@ -0,0 +1,29 @@
+#pragma once
+#include <cmath>
+#include <cstdio>
+
+// Bare checks so the tests build anywhere the library does. A test's main returns testResult().
+inline int g_failures = 0;
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+			g_failures++; \
+		} \
+	} while (0)
+
+#define CHECK_NEAR(value, expected, tolerance) \
+	do { \
+		double checkValue = (value); \
+		double checkExpected = (expected); \
+		if (!(std::fabs(checkValue - checkExpected) <= (tolerance))) { \
+			std::fprintf(stderr, "%s:%d: CHECK_NEAR(%s, %s) failed: %f vs %f\n", __FILE__, __LINE__, #value, #expected, checkValue, checkExpected); \
+			g_failures++; \
+		} \
+	} while (0)
+
+inline int testResult() {
+	if (g_failures) std::fprintf(stderr, "%d check(s) failed\n", g_failures);
+	return g_failures ? 1 : 0;
+}